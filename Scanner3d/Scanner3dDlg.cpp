@@ -75,6 +75,8 @@ CScanner3dDlg::CScanner3dDlg(CWnd* pParent /*=NULL*/)
 	, m_log(_T(""))
 	, m_sldBrightness(255)
 	, m_brightoffset(0)
+	, m_liveframes(-1)
+	, m_spoolfailed(false)
 {
 	m_hIcon = AfxGetApp()->LoadIcon(IDR_MAINFRAME);
 }
@@ -108,6 +110,8 @@ BEGIN_MESSAGE_MAP(CScanner3dDlg, CDialog)
 	ON_BN_CLICKED(IDC_CALIBERATE, &CScanner3dDlg::OnBnClickedCaliberate)
 	ON_BN_CLICKED(IDC_STARTSCANNING, &CScanner3dDlg::OnBnClickedStartscanning)
 	ON_BN_CLICKED(IDC_SAVEDATA, &CScanner3dDlg::OnBnClickedSavedata)
+	ON_BN_CLICKED(IDC_SAVEMESH, &CScanner3dDlg::OnBnClickedSavemesh)
+	ON_BN_CLICKED(IDC_SAVEMERGED, &CScanner3dDlg::OnBnClickedSavemerged)
 	ON_BN_CLICKED(IDC_CONNECT, &CScanner3dDlg::OnBnClickedConnect)
 	ON_CBN_SELCHANGE(IDC_DISPLAY, &CScanner3dDlg::OnCbnSelchangeDisplay)
 	ON_BN_CLICKED(IDC_CMDPOSTPROCESS, &CScanner3dDlg::OnBnClickedCmdpostprocess)
@@ -268,6 +272,7 @@ void CScanner3dDlg::OnBnClickedStartscanning()
 			GetFromScreen();		
 			AddMessage("Starting Scan");
 			
+			m_spoolfailed = false;
 			pScanner->StartScan();
 			this->m_startstopscan.SetWindowTextA("Stop Scanning");
 		}
@@ -315,6 +320,26 @@ void CScanner3dDlg::OnTimer(UINT nIDEvent)
 		{
 			// the scanner converts it to greyscale and manages the resources internally
 			pScanner->ProcessFrame(0.0f); // assume 0 rotation for now.
+			pScanner->CollectFrames(); // keeps the live merge up to date
+			LiveMerge *live = pScanner->GetLiveMerge();
+			if(live->NumFrames() != m_liveframes)
+			{
+				m_liveframes = live->NumFrames();
+				CString caption;
+				caption.Format("3D Laser Scanner - %d frames, %d points, %d merged",m_liveframes,live->NumPoints(),live->NumPixels());
+				SetWindowText(caption);
+			}
+			int budget = pScanner->pConfig->m_spoolbudgetmb;
+			if(budget > 0 && !m_spoolfailed && pScanner->MemoryUsed() > (size_t)budget * 1024 * 1024)
+			{
+				if(!pScanner->IsSpooled())
+					AddMessage("Scan is larger than the memory budget - spooling to disk");
+				if(pScanner->SpoolFrames() < 0)
+				{
+					m_spoolfailed = true; // don't try again every frame, the rest of the scan stays in memory
+					AddMessage("Could not write the spool file - keeping the scan in memory");
+				}
+			}
 		}
 
 		switch(pScanner->pConfig->m_scantype)
@@ -343,7 +368,7 @@ void CScanner3dDlg::OnTimer(UINT nIDEvent)
 
 void CScanner3dDlg::DoLaserLinePlane(IplImage * image)
 {
-	List pnts;
+	Array<Point2D *> pnts;
 	float m,b;
 	int width = 640; // this needs to be real image width
 	Point2D tmppnts[50];
@@ -370,7 +395,7 @@ void CScanner3dDlg::DoLaserLinePlane(IplImage * image)
 	DrawLine(p1.X,p1.Y,p2.X,p2.Y);
 	//release the points
 
-	pnts.Destroy();
+	pnts.Clear();
 	for(int xpos = 0; xpos < 50 ; xpos ++)
 	{
 		int ypos = pScanner->FindLaser(image,xpos + (width-50));
@@ -508,9 +533,14 @@ void CScanner3dDlg::OnBnClickedSavedata()
 	{
 		//pScanner->SaveData((char *)(const char *)FileDlg.GetFileName());
 		PostProcessor pp;		
-		List lst;
-		pp.Composite(&lst); // simple raw export
-		pp.SaveData((char *)(const char *)FileDlg.GetFileName(),&lst);
+		ScanPoint *pnts;
+		int numpnts = pp.CompositePoints(&pnts); // simple raw export, spooled frames included
+		numpnts = pp.Filter(pnts,numpnts); // minus the outliers, if any filters are set up
+		float *normals = new float[(numpnts > 0 ? numpnts : 1) * 3];
+		pp.EstimateNormals(pnts,numpnts,false,normals); // several points per pixel, not organized
+		pp.SaveData((char *)(const char *)FileDlg.GetFileName(),pnts,numpnts,normals);
+		delete []normals;
+		delete []pnts;
 
 	}
 	else
@@ -518,6 +548,64 @@ void CScanner3dDlg::OnBnClickedSavedata()
 
 }
 
+/*
+Save the merge, one point per pixel. A scan that has been spooled is
+merged from disk within the merge budget (see StreamMerger), without normals
+*/
+void CScanner3dDlg::OnBnClickedSavemerged()
+{
+	char strFilter[] = { "PLY Files (*.ply)|*.ply|All Files (*.*)|*.*||" };
+
+	CFileDialog FileDlg(FALSE, NULL, NULL, 0, (LPCTSTR)strFilter);
+
+	if( FileDlg.DoModal() == IDOK )
+	{
+		PostProcessor pp;
+		if(ImProc::Instance()->GetReference() == 0)
+		{
+			AddMessage("No reference image - cannot merge the scan");
+			return;
+		}
+		if(pScanner->IsSpooled())
+		{
+			if(pp.MergeSpool((char *)(const char *)FileDlg.GetFileName(),pScanner->pConfig->m_mergebudgetmb) < 0)
+				AddMessage("Could not merge the spooled scan");
+			else
+				AddMessage("Merged scan saved");
+			return;
+		}
+		// the live merge
+		ScanPoint *pnts;
+		int numpnts = pp.MergePoints(&pnts);
+		numpnts = pp.Filter(pnts,numpnts); // minus the outliers, if any filters are set up
+		float *normals = new float[(numpnts > 0 ? numpnts : 1) * 3];
+		// still one point per pixel unless the voxel filter has averaged them
+		pp.EstimateNormals(pnts,numpnts,pScanner->pConfig->m_filtervoxel <= 0,normals);
+		pp.SaveData((char *)(const char *)FileDlg.GetFileName(),pnts,numpnts,normals);
+		delete []normals;
+		delete []pnts;
+		AddMessage("Merged scan saved");
+	}
+}
+
+// merge the scan, mesh it on the image grid and save it as a PLY with faces
+void CScanner3dDlg::OnBnClickedSavemesh()
+{
+	char strFilter[] = { "PLY Files (*.ply)|*.ply|All Files (*.*)|*.*||" };
+
+	CFileDialog FileDlg(FALSE, NULL, NULL, 0, (LPCTSTR)strFilter);
+
+	if( FileDlg.DoModal() == IDOK )
+	{
+		PostProcessor pp;
+		// edges longer than 5mm span a depth jump, they're left open
+		if(pp.SaveMergedMesh((char *)(const char *)FileDlg.GetFileName(),5.0f))
+			AddMessage("Mesh saved");
+		else
+			AddMessage("No reference image - cannot mesh the scan");
+	}
+}
+
 void CScanner3dDlg::OnBnClickedConnect()
 {
 	if(ImProc::Instance()->VideoConnected() == true)
@@ -527,7 +615,8 @@ void CScanner3dDlg::OnBnClickedConnect()
 		AddMessage("Disconnected from Video Device");
 		KillTimer(1);
 	}else{
-		if(ImProc::Instance()->StartVideo(0))
+		ScannerConfig *cfg = pScanner->pConfig;
+		if(ImProc::Instance()->StartVideo(0,cfg->m_capturewidth,cfg->m_captureheight,cfg->m_capturefps,cfg->m_captureformat))
 		{
 			m_cmdConnect.SetWindowTextA("Disconnect Camera");
 			AddMessage("Connected to Video Device");
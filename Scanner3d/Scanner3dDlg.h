@@ -61,6 +61,8 @@ public:
 
 	afx_msg void OnBnClickedStopscanning2();
 	afx_msg void OnBnClickedSavedata();
+	afx_msg void OnBnClickedSavemesh();
+	afx_msg void OnBnClickedSavemerged();
 	CString m_log;
 	afx_msg void OnBnClickedConnect();
 	void AddMessage(CString message);
@@ -90,4 +92,6 @@ public:
 	CSliderCtrl m_sldbright;
 	int m_brightoffset;
 	CSliderCtrl m_sldbroffset;
+	int m_liveframes; // frames in the live merge when the caption was last updated
+	bool m_spoolfailed; // this scan couldn't be spooled, it stays in memory
 };
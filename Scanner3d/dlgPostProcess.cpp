@@ -30,6 +30,7 @@ BEGIN_MESSAGE_MAP(dlgPostProcess, CDialog)
 	ON_BN_CLICKED(IDC_MERGE, &dlgPostProcess::OnBnClickedMerge)
 	ON_BN_CLICKED(IDC_SAVE, &dlgPostProcess::OnBnClickedSave)
 	ON_BN_CLICKED(IDC_CLEAR, &dlgPostProcess::OnBnClickedClear)
+	ON_BN_CLICKED(IDC_SAVECLOUDMESH, &dlgPostProcess::OnBnClickedSavecloudmesh)
 END_MESSAGE_MAP()
 
 
@@ -63,3 +64,18 @@ void dlgPostProcess::OnBnClickedClear()
 {
 	m_points.Destroy();// this will leak memory
 }
+
+// meshes every point of every frame, for scans that aren't one point per pixel
+void dlgPostProcess::OnBnClickedSavecloudmesh()
+{
+	char strFilter[] = { "PLY Files (*.ply)|*.ply|All Files (*.*)|*.*||" };
+
+	CFileDialog FileDlg(FALSE, NULL, NULL, 0, (LPCTSTR)strFilter);
+
+	if( FileDlg.DoModal() == IDOK )
+	{
+		PostProcessor pp;
+		// same 5mm depth jump limit as the main dialog's Save Mesh
+		pp.SaveCloudMesh((char *)(const char *)FileDlg.GetFileName(),5.0f);
+	}
+}
@@ -8,7 +8,7 @@ class dlgPostProcess : public CDialog
 	DECLARE_DYNAMIC(dlgPostProcess)
 	
 public:
-	List m_points; // the current set of points we're working with
+	Array<point_3d *> m_points; // the current set of points we're working with
 	dlgPostProcess(CWnd* pParent = NULL);   // standard constructor
 	virtual ~dlgPostProcess();
 
@@ -23,4 +23,5 @@ public:
 	afx_msg void OnBnClickedMerge();
 	afx_msg void OnBnClickedSave();
 	afx_msg void OnBnClickedClear();
+	afx_msg void OnBnClickedSavecloudmesh();
 };
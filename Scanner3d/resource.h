@@ -48,6 +48,9 @@
 #define IDC_BRIGHTNESS                  1030
 #define IDC_BRIGHTNESS2                 1031
 #define IDC_BRIGHTOFFSET                1031
+#define IDC_SAVEMESH                    1032
+#define IDC_SAVECLOUDMESH               1033
+#define IDC_SAVEMERGED                  1034
 
 // Next default values for new objects
 // 
@@ -55,7 +58,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        133
 #define _APS_NEXT_COMMAND_VALUE         32771
-#define _APS_NEXT_CONTROL_VALUE         1031
+#define _APS_NEXT_CONTROL_VALUE         1035
 #define _APS_NEXT_SYMED_VALUE           104
 #endif
 #endif
@@ -0,0 +1,239 @@
+#pragma once
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "ScanArena.h"
+/*
+Array is a typed, contiguous, growable container, it replaces the old
+void * linked List. Add is amortized O(1), indexing is O(1) and
+RemoveAt is O(1) (the last item is moved into the hole, so the order
+isn't kept, use RemoveAtOrdered if it matters).
+
+The items are moved around with memcpy, so T must be plain data:
+pointers, numbers or simple structs like ScanPoint.
+
+The storage can come from a ScanArena, in which case growing leaves the
+old storage in the arena and nothing is ever freed (the arena is reset
+at the end of the scan).
+
+PtrSet is a pointer array with a hash index on the side, for the places
+that need to reject duplicates or remove items by pointer. Add, InList and
+Remove are all O(1). The index of an item changes when something else is
+removed, the pointer itself is the stable handle.
+*/
+template <class T> class Array
+{
+public:
+	Array(int reserve = 0,ScanArena *arena = 0)
+	{
+		m_data = 0;
+		m_count = 0;
+		m_capacity = 0;
+		m_arena = arena;
+		if(reserve > 0)
+			Reserve(reserve);
+	}
+	~Array()
+	{
+		Destroy();
+	}
+	int Add(const T &item)
+	{
+		if(m_count == m_capacity)
+			Reserve(m_capacity < 16 ? 16 : m_capacity * 2);
+		m_data[m_count] = item;
+		return m_count++;
+	}
+	T &operator[](int index){return m_data[index];}
+	T &GetItem(int index){return m_data[index];}
+	int Count(){return m_count;}
+	T *Data(){return m_data;}
+	// O(1), the last item takes this one's place
+	void RemoveAt(int index)
+	{
+		m_data[index] = m_data[--m_count];
+	}
+	// O(n), keeps the order
+	void RemoveAtOrdered(int index)
+	{
+		memmove(&m_data[index],&m_data[index + 1],sizeof(T) * (m_count - index - 1));
+		m_count--;
+	}
+	// O(n) search, -1 if not found
+	int IndexOf(const T &item)
+	{
+		for(int i = 0; i < m_count; i++)
+			if(memcmp(&m_data[i],&item,sizeof(T)) == 0)
+				return i;
+		return -1;
+	}
+	bool Remove(const T &item)
+	{
+		int index = IndexOf(item);
+		if(index == -1)
+			return false;
+		RemoveAt(index);
+		return true;
+	}
+	void Reserve(int capacity)
+	{
+		if(capacity <= m_capacity)
+			return;
+		T *data;
+		if(m_arena)
+		{
+			data = (T *)m_arena->Alloc(sizeof(T) * capacity);
+			if(m_count > 0)
+				memcpy(data,m_data,sizeof(T) * m_count);
+		}
+		else
+		{
+			data = (T *)realloc(m_data,sizeof(T) * capacity);
+			if(data == 0)
+				throw std::bad_alloc();
+		}
+		m_data = data;
+		m_capacity = capacity;
+	}
+	// forget the items but keep the storage
+	void Clear(){m_count = 0;}
+	// forget the items and free the storage
+	void Destroy()
+	{
+		if(!m_arena)
+			free(m_data);
+		m_data = 0;
+		m_count = 0;
+		m_capacity = 0;
+	}
+private:
+	T *m_data;
+	int m_count;
+	int m_capacity;
+	ScanArena *m_arena;
+	// no copying, these are passed around by pointer like the List was
+	Array(const Array &);
+	Array &operator=(const Array &);
+};
+
+template <class T> class PtrSet
+{
+public:
+	PtrSet()
+	{
+		m_slots = 0;
+		m_numslots = 0;
+	}
+	~PtrSet()
+	{
+		Destroy();
+	}
+	// returns false if it's already in the set
+	bool Add(T *item)
+	{
+		if((m_items.Count() + 1) * 2 > m_numslots)
+			Rehash(m_numslots < 32 ? 32 : m_numslots * 2);
+		int slot = Find(item);
+		if(m_slots[slot].item == item)
+			return false;
+		m_slots[slot].item = item;
+		m_slots[slot].index = m_items.Add(item);
+		return true;
+	}
+	bool InList(T *item)
+	{
+		return m_numslots > 0 && m_slots[Find(item)].item == item;
+	}
+	bool Remove(T *item)
+	{
+		if(m_numslots == 0)
+			return false;
+		int slot = Find(item);
+		if(m_slots[slot].item != item)
+			return false;
+		int index = m_slots[slot].index;
+		int last = m_items.Count() - 1;
+		if(index != last)
+		{
+			//the last item moves into the hole, fix up its index
+			m_slots[Find(m_items[last])].index = index;
+		}
+		m_items.RemoveAt(index);
+		Erase(slot);
+		return true;
+	}
+	T *operator[](int index){return m_items[index];}
+	T *GetItem(int index){return m_items[index];}
+	int Count(){return m_items.Count();}
+	void Destroy()
+	{
+		m_items.Destroy();
+		delete []m_slots;
+		m_slots = 0;
+		m_numslots = 0;
+	}
+private:
+	struct Slot
+	{
+		T *item; // 0 = empty
+		int index; // where it is in m_items
+	};
+	Array<T *> m_items;
+	Slot *m_slots; // open addressing, linear probing, m_numslots is a power of 2
+	int m_numslots;
+
+	int Hash(T *item)
+	{
+		size_t h = (size_t)item;
+		h ^= h >> 16;
+		h *= 0x45d9f3b;
+		h ^= h >> 16;
+		return (int)(h & (m_numslots - 1));
+	}
+	// the slot holding item, or the empty slot where it would go
+	int Find(T *item)
+	{
+		int slot = Hash(item);
+		while(m_slots[slot].item != 0 && m_slots[slot].item != item)
+			slot = (slot + 1) & (m_numslots - 1);
+		return slot;
+	}
+	// remove a slot without leaving a tombstone, the following entries are shifted back
+	void Erase(int slot)
+	{
+		int mask = m_numslots - 1;
+		int next = slot;
+		for(;;)
+		{
+			m_slots[slot].item = 0;
+			for(;;)
+			{
+				next = (next + 1) & mask;
+				if(m_slots[next].item == 0)
+					return;
+				int home = Hash(m_slots[next].item);
+				//can the entry at next be moved back into slot?
+				if(slot <= next ? (home <= slot || home > next) : (home <= slot && home > next))
+					break;
+			}
+			m_slots[slot] = m_slots[next];
+			slot = next;
+		}
+	}
+	void Rehash(int numslots)
+	{
+		delete []m_slots;
+		m_slots = new Slot[numslots];
+		m_numslots = numslots;
+		for(int i = 0; i < numslots; i++)
+			m_slots[i].item = 0;
+		for(int i = 0; i < m_items.Count(); i++)
+		{
+			int slot = Find(m_items[i]);
+			m_slots[slot].item = m_items[i];
+			m_slots[slot].index = i;
+		}
+	}
+	PtrSet(const PtrSet &);
+	PtrSet &operator=(const PtrSet &);
+};
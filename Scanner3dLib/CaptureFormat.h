@@ -0,0 +1,13 @@
+#pragma once
+/*
+The pixel layouts ImProc can take from the camera.
+For anything other than BGR, the luma (Y) plane is used directly as the
+greyscale frame and color is only worked out for the pixels that need it.
+*/
+enum ePixelFormat
+{
+	ePixelBGR = 0, // 3 bytes per pixel, what OpenCV normally hands back
+	ePixelYUYV = 1, // packed 4:2:2, Y0 U Y1 V
+	ePixelNV12 = 2, // Y plane followed by an interleaved UV plane at half resolution
+	ePixelGrey = 3, // Y plane only
+};
@@ -0,0 +1,371 @@
+#include "DelaunayFast.h"
+#include <stdlib.h>
+#include <float.h>
+
+DelaunayFast::DelaunayFast()
+{
+	m_x = 0;
+	m_y = 0;
+	m_last = 0;
+	m_skipped = 0;
+}
+
+DelaunayFast::~DelaunayFast()
+{
+	delete []m_x;
+	delete []m_y;
+}
+
+struct BRIOKey
+{
+	int round;
+	unsigned int hilbert;
+	int index;
+};
+
+static int CompareBRIO(const void *a,const void *b)
+{
+	const BRIOKey *ka = (const BRIOKey *)a;
+	const BRIOKey *kb = (const BRIOKey *)b;
+	if(ka->round != kb->round)
+		return ka->round < kb->round ? -1 : 1;
+	if(ka->hilbert != kb->hilbert)
+		return ka->hilbert < kb->hilbert ? -1 : 1;
+	return ka->index - kb->index;
+}
+
+// distance along the Hilbert curve of (x,y) on a 65536 x 65536 grid
+static unsigned int HilbertIndex(unsigned int x,unsigned int y)
+{
+	unsigned int d = 0;
+	for(unsigned int s = 1 << 15; s > 0; s >>= 1)
+	{
+		unsigned int rx = (x & s) > 0;
+		unsigned int ry = (y & s) > 0;
+		d += s * s * ((3 * rx) ^ ry);
+		//rotate the quadrant
+		if(ry == 0)
+		{
+			if(rx == 1)
+			{
+				x = s - 1 - (x & (s - 1));
+				y = s - 1 - (y & (s - 1));
+			}
+			unsigned int t = x;
+			x = y;
+			y = t;
+		}
+	}
+	return d;
+}
+
+/*
+Biased randomized insertion order: each point goes in the last round with
+probability 1/2, the one before with 1/4 and so on, the rounds are inserted
+smallest first and each round is sorted along the Hilbert curve.
+The randomness keeps the expected work low, the curve keeps the walks short.
+A fixed seed makes the result repeatable.
+*/
+void DelaunayFast::SortBRIO(ScanPoint *pnts,int numpnts,int *order)
+{
+	float minx = FLT_MAX,miny = FLT_MAX,maxx = -FLT_MAX,maxy = -FLT_MAX;
+	for(int i = 0; i < numpnts; i++)
+	{
+		if(pnts[i].x < minx) minx = pnts[i].x;
+		if(pnts[i].x > maxx) maxx = pnts[i].x;
+		if(pnts[i].y < miny) miny = pnts[i].y;
+		if(pnts[i].y > maxy) maxy = pnts[i].y;
+	}
+	float scale = maxx - minx > maxy - miny ? maxx - minx : maxy - miny;
+	scale = scale > 0 ? 65535.0f / scale : 0;
+	int maxround = 0;
+	while((2 << maxround) < numpnts)
+		maxround++;
+
+	BRIOKey *keys = new BRIOKey[numpnts];
+	unsigned int seed = 12345;
+	for(int i = 0; i < numpnts; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		unsigned int bits = seed >> 8;
+		int level = 0;
+		while((bits & 1) && level < maxround)
+		{
+			level++;
+			bits >>= 1;
+		}
+		keys[i].round = maxround - level;
+		keys[i].hilbert = HilbertIndex((unsigned int)((pnts[i].x - minx) * scale),(unsigned int)((pnts[i].y - miny) * scale));
+		keys[i].index = i;
+	}
+	qsort(keys,numpnts,sizeof(BRIOKey),CompareBRIO);
+	for(int i = 0; i < numpnts; i++)
+		order[i] = keys[i].index;
+	delete []keys;
+}
+
+// > 0 if p is left of a->b (a,b,p counter-clockwise), 0 if on the line
+double DelaunayFast::Orient(int a,int b,int p)
+{
+	return (m_x[b] - m_x[a]) * (m_y[p] - m_y[a]) - (m_y[b] - m_y[a]) * (m_x[p] - m_x[a]);
+}
+
+// is p strictly inside the circumcircle of the counter-clockwise triangle a,b,c
+bool DelaunayFast::InCircle(int a,int b,int c,int p)
+{
+	double ax = m_x[a] - m_x[p],ay = m_y[a] - m_y[p];
+	double bx = m_x[b] - m_x[p],by = m_y[b] - m_y[p];
+	double cx = m_x[c] - m_x[p],cy = m_y[c] - m_y[p];
+	double det = (ax * ax + ay * ay) * (bx * cy - cx * by)
+		- (bx * bx + by * by) * (ax * cy - cx * ay)
+		+ (cx * cx + cy * cy) * (ax * by - bx * ay);
+	return det > 0;
+}
+
+void DelaunayFast::SetTri(int t,int a,int b,int c,int na,int nb,int nc)
+{
+	DTri *tri = &m_tris[t];
+	tri->v[0] = a;
+	tri->v[1] = b;
+	tri->v[2] = c;
+	tri->n[0] = na;
+	tri->n[1] = nb;
+	tri->n[2] = nc;
+}
+
+int DelaunayFast::AddTri(int a,int b,int c,int na,int nb,int nc)
+{
+	DTri tri;
+	int t = m_tris.Add(tri);
+	SetTri(t,a,b,c,na,nb,nc);
+	return t;
+}
+
+// the neighbour t used to point at from now points at to
+void DelaunayFast::Relink(int t,int from,int to)
+{
+	if(t == -1)
+		return;
+	DTri *tri = &m_tris[t];
+	for(int i = 0; i < 3; i++)
+	{
+		if(tri->n[i] == from)
+		{
+			tri->n[i] = to;
+			return;
+		}
+	}
+}
+
+/*
+Walk from m_last towards p, crossing any edge that p is on the far side of.
+Returns the triangle containing p, *edge = -1 if p is inside it, or the
+edge p lies on. Returns -1 if p is on top of an existing vertex.
+The edge tested first rotates each step, so the walk can't circle.
+*/
+int DelaunayFast::Locate(int p,int *edge)
+{
+	int t = m_last;
+	int step = 0;
+	for(;;)
+	{
+		DTri *tri = &m_tris[t];
+		int next = -1;
+		int onedge = -1;
+		int numon = 0;
+		for(int k = 0; k < 3; k++)
+		{
+			int e = (k + step) % 3;
+			double o = Orient(tri->v[(e + 1) % 3],tri->v[(e + 2) % 3],p);
+			if(o < 0)
+			{
+				next = tri->n[e];
+				break;
+			}
+			if(o == 0)
+			{
+				onedge = e;
+				numon++;
+			}
+		}
+		if(next == -1)
+		{
+			if(numon >= 2)
+				return -1;
+			*edge = onedge;
+			return t;
+		}
+		t = next;
+		step++;
+	}
+}
+
+/*
+p inside t = (a,b,c), make (p,b,c) (p,c,a) (p,a,b)
+*/
+void DelaunayFast::SplitTri(int t,int p)
+{
+	DTri tri = m_tris[t];
+	int a = tri.v[0],b = tri.v[1],c = tri.v[2];
+	int t1 = m_tris.Count();
+	int t2 = t1 + 1;
+	SetTri(t,p,b,c,tri.n[0],t1,t2);
+	AddTri(p,c,a,tri.n[1],t2,t);
+	AddTri(p,a,b,tri.n[2],t,t1);
+	Relink(tri.n[1],t,t1);
+	Relink(tri.n[2],t,t2);
+	m_stack.Add(t);
+	m_stack.Add(t1);
+	m_stack.Add(t2);
+}
+
+/*
+p on the edge opposite vertex e of t, t = (a,b,c) with p on b-c
+o = (d,c,b) is the triangle on the other side, both are split in 2:
+(p,c,a) (p,a,b) (p,b,d) (p,d,c)
+*/
+void DelaunayFast::SplitEdge(int t,int e,int p)
+{
+	DTri tri = m_tris[t];
+	int a = tri.v[e],b = tri.v[(e + 1) % 3],c = tri.v[(e + 2) % 3];
+	int nb = tri.n[(e + 1) % 3],nc = tri.n[(e + 2) % 3];
+	int o = tri.n[e];
+	if(o == -1)
+	{
+		//on the enclosing triangle, can't happen unless the points are huge
+		SplitTri(t,p);
+		return;
+	}
+	DTri otri = m_tris[o];
+	int j = 0;
+	while(otri.n[j] != t)
+		j++;
+	int d = otri.v[j];
+	int obd = otri.n[(j + 1) % 3],odc = otri.n[(j + 2) % 3];
+	int t1 = m_tris.Count();
+	int o1 = t1 + 1;
+	SetTri(t,p,c,a,nb,t1,o1);
+	AddTri(p,a,b,nc,o,t);
+	SetTri(o,p,b,d,obd,o1,t1);
+	AddTri(p,d,c,odc,t,o);
+	Relink(nc,t,t1);
+	Relink(odc,o,o1);
+	m_stack.Add(t);
+	m_stack.Add(t1);
+	m_stack.Add(o);
+	m_stack.Add(o1);
+}
+
+/*
+Lawson flips, every triangle on the stack has p as v[0],
+the edge to test is the one opposite p
+*/
+void DelaunayFast::Legalize(int p)
+{
+	while(m_stack.Count() > 0)
+	{
+		int t = m_stack[m_stack.Count() - 1];
+		m_stack.RemoveAt(m_stack.Count() - 1);
+		DTri tri = m_tris[t];
+		int o = tri.n[0];
+		if(o == -1)
+			continue;
+		DTri otri = m_tris[o];
+		int j = 0;
+		while(otri.n[j] != t)
+			j++;
+		int d = otri.v[j];
+		if(!InCircle(tri.v[0],tri.v[1],tri.v[2],d))
+			continue;
+		// t = (p,a,b), o = (d,b,a) -> t = (p,a,d), o = (p,d,b)
+		int a = tri.v[1],b = tri.v[2];
+		int oad = otri.n[(j + 1) % 3],odb = otri.n[(j + 2) % 3];
+		SetTri(t,p,a,d,oad,o,tri.n[2]);
+		SetTri(o,p,d,b,odb,tri.n[1],t);
+		Relink(oad,o,t);
+		Relink(tri.n[1],t,o);
+		m_stack.Add(t);
+		m_stack.Add(o);
+	}
+}
+
+void DelaunayFast::Insert(int p)
+{
+	int edge;
+	int t = Locate(p,&edge);
+	if(t == -1)
+	{
+		m_skipped++;
+		return;
+	}
+	if(edge == -1)
+		SplitTri(t,p);
+	else
+		SplitEdge(t,edge,p);
+	Legalize(p);
+	m_last = t;
+}
+
+int DelaunayFast::Triangulate(ScanPoint *pnts,int numpnts,int **tris)
+{
+	*tris = 0;
+	m_skipped = 0;
+	m_tris.Clear();
+	m_stack.Clear();
+	delete []m_x;
+	delete []m_y;
+	m_x = new double[numpnts + 3];
+	m_y = new double[numpnts + 3];
+	if(numpnts < 3)
+		return 0;
+
+	double minx = DBL_MAX,miny = DBL_MAX,maxx = -DBL_MAX,maxy = -DBL_MAX;
+	for(int i = 0; i < numpnts; i++)
+	{
+		m_x[i] = pnts[i].x;
+		m_y[i] = pnts[i].y;
+		if(m_x[i] < minx) minx = m_x[i];
+		if(m_x[i] > maxx) maxx = m_x[i];
+		if(m_y[i] < miny) miny = m_y[i];
+		if(m_y[i] > maxy) maxy = m_y[i];
+	}
+	//the enclosing triangle, far enough out that it hardly affects the hull
+	double cx = (minx + maxx) / 2,cy = (miny + maxy) / 2;
+	double size = (maxx - minx > maxy - miny ? maxx - minx : maxy - miny) + 1;
+	int s0 = numpnts,s1 = numpnts + 1,s2 = numpnts + 2;
+	m_x[s0] = cx - 1000 * size; m_y[s0] = cy - 1000 * size;
+	m_x[s1] = cx + 1000 * size; m_y[s1] = cy - 1000 * size;
+	m_x[s2] = cx; m_y[s2] = cy + 1000 * size;
+	m_tris.Reserve(numpnts * 2 + 1);
+	AddTri(s0,s1,s2,-1,-1,-1);
+	m_last = 0;
+
+	int *order = new int[numpnts];
+	SortBRIO(pnts,numpnts,order);
+	for(int i = 0; i < numpnts; i++)
+		Insert(order[i]);
+	delete []order;
+
+	//drop the triangles that touch the enclosing triangle
+	int num = 0;
+	for(int i = 0; i < m_tris.Count(); i++)
+		if(m_tris[i].v[0] < numpnts && m_tris[i].v[1] < numpnts && m_tris[i].v[2] < numpnts)
+			num++;
+	if(num == 0)
+		return 0;
+	int *out = new int[num * 3];
+	int *dst = out;
+	for(int i = 0; i < m_tris.Count(); i++)
+	{
+		DTri *tri = &m_tris[i];
+		if(tri->v[0] < numpnts && tri->v[1] < numpnts && tri->v[2] < numpnts)
+		{
+			dst[0] = tri->v[0];
+			dst[1] = tri->v[1];
+			dst[2] = tri->v[2];
+			dst += 3;
+		}
+	}
+	*tris = out;
+	return num;
+}
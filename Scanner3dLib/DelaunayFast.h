@@ -0,0 +1,58 @@
+#pragma once
+#include "Array.h"
+#include "ScanPoint.h"
+/*
+Fast 2.5D Delaunay triangulation (on x,y, z is carried along) for
+unorganized point clouds, the accelerated version of DelaunayT.
+
+DelaunayT searches for the containing triangle from a fixed edge and
+allocates every edge and triangle on the heap, which makes it roughly
+O(n^2) and impractical past a few thousand points. This one:
+	- inserts the points in BRIO order (random rounds of doubling size,
+	  Hilbert curve order inside each round), so consecutive points
+	  are close together
+	- locates each point by walking from the last triangle that was made,
+	  which with the ordering above is only a few steps
+	- keeps the triangles in one pooled Array and refers to them by index.
+	  Each triangle stores its 3 vertices and the 3 neighbouring triangles,
+	  the edges are implicit (edge i of a triangle is the one opposite vertex i)
+	  so there are no edge objects to allocate at all
+Expected time is O(n log n), a million points takes a second or two.
+
+The points are inserted into a large enclosing triangle that is removed
+at the end. Points that land on an existing vertex are skipped.
+*/
+class DelaunayFast
+{
+public:
+	DelaunayFast();
+	~DelaunayFast();
+	// returns the number of triangles, *tris gets 3 point indices per triangle (new[], caller frees)
+	// the triangles are counter-clockwise in x,y
+	int Triangulate(ScanPoint *pnts,int numpnts,int **tris);
+	int NumSkipped(){return m_skipped;}
+private:
+	struct DTri
+	{
+		int v[3]; // vertices, counter-clockwise
+		int n[3]; // n[i] is the triangle across the edge opposite v[i], -1 = none
+	};
+	Array<DTri> m_tris;
+	Array<int> m_stack; // triangles waiting for the flip test
+	double *m_x; // point coordinates, the enclosing triangle is at numpnts..numpnts+2
+	double *m_y;
+	int m_last; // where the next walk starts
+	int m_skipped;
+
+	void SortBRIO(ScanPoint *pnts,int numpnts,int *order);
+	double Orient(int a,int b,int p);
+	bool InCircle(int a,int b,int c,int p);
+	int Locate(int p,int *edge);
+	void Insert(int p);
+	void SplitTri(int t,int p);
+	void SplitEdge(int t,int e,int p);
+	void Legalize(int p);
+	void Relink(int t,int from,int to);
+	int AddTri(int a,int b,int c,int na,int nb,int nc);
+	void SetTri(int t,int a,int b,int c,int na,int nb,int nc);
+};
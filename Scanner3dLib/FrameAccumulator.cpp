@@ -0,0 +1,69 @@
+#include "FrameAccumulator.h"
+#include <windows.h>
+
+FrameAccumulator::FrameAccumulator()
+{
+	m_head = 0;
+	m_numframes = 0;
+	m_numpoints = 0;
+}
+
+/*
+Any frames that were never collected are freed
+*/
+FrameAccumulator::~FrameAccumulator()
+{
+	Array<ScannerFrame *> leftover;
+	Collect(&leftover);
+	for(int c = 0; c < leftover.Count(); c++)
+		ScannerFrame::Free(leftover[c]);
+}
+
+void FrameAccumulator::Publish(ScannerFrame *sf)
+{
+	FrameNode *node = new FrameNode();
+	node->frame = sf;
+	//once it's on the stack the reader can take it, don't touch it after that
+	long numpoints = sf->m_pPoints->Count();
+	void *head;
+	do
+	{
+		head = m_head;
+		node->next = (FrameNode *)head;
+	}while(InterlockedCompareExchangePointer(&m_head,node,head) != head);
+	InterlockedIncrement((volatile LONG *)&m_numframes);
+	InterlockedExchangeAdd((volatile LONG *)&m_numpoints,numpoints);
+}
+
+/*
+Take everything published so far, the stack is newest first
+so it's reversed before adding to keep the publish order
+*/
+int FrameAccumulator::Collect(Array<ScannerFrame *> *frames)
+{
+	FrameNode *node = (FrameNode *)InterlockedExchangePointer(&m_head,0);
+	FrameNode *ordered = 0;
+	while(node != 0)
+	{
+		FrameNode *next = node->next;
+		node->next = ordered;
+		ordered = node;
+		node = next;
+	}
+	int count = 0;
+	while(ordered != 0)
+	{
+		FrameNode *next = ordered->next;
+		frames->Add(ordered->frame);
+		delete ordered;
+		ordered = next;
+		count++;
+	}
+	return count;
+}
+
+void FrameAccumulator::ResetCounts()
+{
+	InterlockedExchange((volatile LONG *)&m_numframes,0);
+	InterlockedExchange((volatile LONG *)&m_numpoints,0);
+}
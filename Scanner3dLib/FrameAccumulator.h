@@ -0,0 +1,38 @@
+#pragma once
+#include "ScannerFrame.h"
+#include "Array.h"
+/*
+This class collects the ScannerFrames produced by ProcessFrame so that
+several threads can be generating frames at once.
+
+Any number of threads can Publish finished frames, this is a lock-free
+push onto a singly linked stack (one compare-exchange per frame, not per point,
+the points are built up privately in the frame before it's published).
+A single reader (the UI, the exporter) calls Collect, which takes the whole
+stack in one atomic exchange and appends it to its own list in publish order.
+The reader's list is never touched by the workers, so it's a consistent snapshot
+between calls to Collect.
+*/
+class FrameAccumulator
+{
+public:
+	FrameAccumulator();
+	~FrameAccumulator();
+	// called from any thread, the accumulator owns the frame from here on
+	void Publish(ScannerFrame *sf);
+	// called from the reader thread only, returns the number of frames moved into frames
+	int Collect(Array<ScannerFrame *> *frames);
+	// totals published so far, safe to read from any thread
+	long FrameCount(){return m_numframes;}
+	long PointCount(){return m_numpoints;}
+	void ResetCounts();
+private:
+	struct FrameNode
+	{
+		ScannerFrame *frame;
+		FrameNode *next;
+	};
+	void * volatile m_head; // FrameNode *, the most recently published frame
+	volatile long m_numframes;
+	volatile long m_numpoints;
+};
@@ -0,0 +1,137 @@
+#include "GridMesher.h"
+#include <string.h>
+
+GridMesher::GridMesher()
+{
+	m_maxedge = 5.0f;
+	m_grid = 0;
+	m_pnts = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+GridMesher::~GridMesher()
+{
+	delete []m_grid;
+}
+
+// squared distance between 2 points
+float GridMesher::Dist2(int a,int b)
+{
+	float dx = m_pnts[a].x - m_pnts[b].x;
+	float dy = m_pnts[a].y - m_pnts[b].y;
+	float dz = m_pnts[a].z - m_pnts[b].z;
+	return dx * dx + dy * dy + dz * dz;
+}
+
+// add the triangle if none of its edges cross a depth discontinuity
+int GridMesher::AddTri(int a,int b,int c,int *out)
+{
+	float max2 = m_maxedge * m_maxedge;
+	if(Dist2(a,b) > max2 || Dist2(b,c) > max2 || Dist2(c,a) > max2)
+		return 0;
+	if(out)
+	{
+		out[0] = a;
+		out[1] = b;
+		out[2] = c;
+	}
+	return 1;
+}
+
+/*
+Triangulate the 2x2 block with (x,y) at the top left
+writes the triangles to out (if not 0) and returns how many there are
+  a - b
+  |   |
+  c - d
+all of the triangles wind the same way in the image
+with all 4 points, the block is split along the shorter diagonal
+*/
+int GridMesher::MeshCell(int x,int y,int *out)
+{
+	int a = m_grid[y * m_width + x];
+	int b = m_grid[y * m_width + x + 1];
+	int c = m_grid[(y + 1) * m_width + x];
+	int d = m_grid[(y + 1) * m_width + x + 1];
+	int valid = (a != -1) + (b != -1) + (c != -1) + (d != -1);
+	int num = 0;
+	if(valid == 4)
+	{
+		if(Dist2(a,d) <= Dist2(b,c))
+		{
+			num = AddTri(a,d,b,out);
+			num += AddTri(a,c,d,out ? out + num * 3 : 0);
+		}
+		else
+		{
+			num = AddTri(a,c,b,out);
+			num += AddTri(b,c,d,out ? out + num * 3 : 0);
+		}
+	}
+	else if(valid == 3)
+	{
+		if(a == -1)
+			num = AddTri(b,c,d,out);
+		else if(b == -1)
+			num = AddTri(a,c,d,out);
+		else if(c == -1)
+			num = AddTri(a,d,b,out);
+		else
+			num = AddTri(a,c,b,out);
+	}
+	return num;
+}
+
+int GridMesher::Triangulate(ScanPoint *pnts,int numpnts,int width,int height,int **tris)
+{
+	*tris = 0;
+	if(width < 2 || height < 2)
+		return 0;
+	if(m_grid == 0 || width != m_width || height != m_height)
+	{
+		delete []m_grid;
+		m_grid = new int[width * height];
+		m_width = width;
+		m_height = height;
+	}
+	m_pnts = pnts;
+	memset(m_grid,0xff,sizeof(int) * width * height); // all -1
+	for(int i = 0; i < numpnts; i++)
+	{
+		int px = pnts[i].PixelX(),py = pnts[i].PixelY();
+		if(px < width && py < height)
+			m_grid[py * width + px] = i;
+	}
+	//count the triangles on each row of cells, then where each row starts in the output
+	int rows = height - 1;
+	int *rowstart = new int[rows + 1];
+	int y;
+#pragma omp parallel for schedule(dynamic,16)
+	for(y = 0; y < rows; y++)
+	{
+		int count = 0;
+		for(int x = 0; x < width - 1; x++)
+			count += MeshCell(x,y,0);
+		rowstart[y] = count;
+	}
+	int total = 0;
+	for(y = 0; y < rows; y++)
+	{
+		int count = rowstart[y];
+		rowstart[y] = total;
+		total += count;
+	}
+	rowstart[rows] = total;
+	int *out = new int[(total > 0 ? total : 1) * 3];
+#pragma omp parallel for schedule(dynamic,16)
+	for(y = 0; y < rows; y++)
+	{
+		int *dst = out + rowstart[y] * 3;
+		for(int x = 0; x < width - 1; x++)
+			dst += MeshCell(x,y,dst) * 3;
+	}
+	delete []rowstart;
+	*tris = out;
+	return total;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "ScanPoint.h"
+/*
+Builds a triangle mesh straight from the image grid the points came from.
+Every scanned point knows its pixel, so neighbouring pixels are neighbouring
+points on the surface, there's no need for a general Delaunay triangulation.
+Each 2x2 block of pixels gives up to 2 triangles, triangles with an edge
+longer than m_maxedge are dropped, those span a depth discontinuity
+(the edge of the object, or object to background).
+
+The rows are independent, so they're counted and then filled in parallel
+(OpenMP), the output is the same as a serial run.
+Expects at most one point per pixel, as produced by PostProcessor::MergePoints
+*/
+class GridMesher
+{
+public:
+	float m_maxedge; // world units (mm)
+
+	GridMesher();
+	~GridMesher();
+	// returns the number of triangles, *tris gets 3 point indices per triangle (new[], caller frees)
+	int Triangulate(ScanPoint *pnts,int numpnts,int width,int height,int **tris);
+private:
+	int *m_grid; // point index at each pixel, -1 = none
+	ScanPoint *m_pnts;
+	int m_width;
+	int m_height;
+	float Dist2(int a,int b);
+	int AddTri(int a,int b,int c,int *out);
+	int MeshCell(int x,int y,int *out);
+};
@@ -1,5 +1,9 @@
 #include "ImProc.h"
 #include "math.h"
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define IMPROC_SSE
+#include <emmintrin.h>
+#endif
 
 //the compiler wasn't seeing these for some reason
 #ifndef max
@@ -23,15 +27,36 @@ ImProc::~ImProc(void)
 {
 }
 
-bool ImProc::StartVideo(int camera)
+bool ImProc::StartVideo(int camera,int width,int height,double fps,ePixelFormat format)
 {
 	if(m_Video == 0)
 	{
 		m_Video=cvCaptureFromCAM(camera); // try to connect to any camera
 		if(m_Video != 0)
 		{
-			cvSetCaptureProperty( m_Video, CV_CAP_PROP_FRAME_WIDTH, 640 );
-			cvSetCaptureProperty( m_Video, CV_CAP_PROP_FRAME_HEIGHT, 480 );
+			cvSetCaptureProperty( m_Video, CV_CAP_PROP_FRAME_WIDTH, width );
+			cvSetCaptureProperty( m_Video, CV_CAP_PROP_FRAME_HEIGHT, height );
+			if(fps > 0)
+				cvSetCaptureProperty( m_Video, CV_CAP_PROP_FPS, fps );
+			m_Format = format;
+			if(format != ePixelBGR)
+			{
+				// ask for the raw frames, not every driver honours this,
+				// so the layout is checked again on every frame
+				switch(format)
+				{
+					case ePixelYUYV:
+						cvSetCaptureProperty( m_Video, CV_CAP_PROP_FOURCC, CV_FOURCC('Y','U','Y','V') );
+						break;
+					case ePixelNV12:
+						cvSetCaptureProperty( m_Video, CV_CAP_PROP_FOURCC, CV_FOURCC('N','V','1','2') );
+						break;
+					default:
+						cvSetCaptureProperty( m_Video, CV_CAP_PROP_FOURCC, CV_FOURCC('G','R','E','Y') );
+						break;
+				}
+				cvSetCaptureProperty( m_Video, CV_CAP_PROP_CONVERT_RGB, 0 );
+			}
 			return true;
 		}
 	}
@@ -61,12 +86,20 @@ void ImProc::Init()
 {
 	offset = 10;
 	m_Video = 0;
+	m_Format = ePixelBGR;
+	m_Layout = ePixelBGR;
 	m_CurFrame = 0; // the current frame (color)
+	m_CurFrameColor = 0;
 	m_CurFrameGrey = 0;
 	m_PrevFrame = 0; // the previous frame of video (color)
+	m_PrevFrameGrey = 0;
+	m_CurGreyIsView = false;
+	m_PrevGreyIsView = false;
 	m_Reference = 0; // the color reference image with no laser line
 	m_ReferenceGrey = 0; // the grey reference image with no laser line
 	m_TemporalImage = 0;// the greyscale diff image between 2 successive frames that has been thresholded
+	for(int i = 0; i < IMPROC_MAX_PYRAMID; i++)
+		m_TemporalPyramid[i] = 0;
 }
 
 
@@ -81,9 +114,21 @@ void ImProc::SetRefImage()
 	//now copy a permanant copy of it into the m_Reference frame
 	if(Frame !=0)
 	{
-		m_Reference = cvCloneImage(Frame);
+		//the reference is always kept in color, it's only taken once
+		ePixelFormat layout = FrameLayout(Frame);
+		m_Reference = (layout == ePixelBGR) ? cvCloneImage(Frame) : ConvertToColor(Frame,layout);
 		//and make a greyscale copy of it
-		m_ReferenceGrey = ConvertToGrey(m_Reference);
+		bool isview;
+		IplImage *grey = LumaImage(Frame,layout,&isview);
+		if(isview)
+		{
+			m_ReferenceGrey = cvCloneImage(grey);
+			ReleaseGrey(&grey,true);
+		}
+		else
+		{
+			m_ReferenceGrey = grey;
+		}
 	}
 }
 
@@ -92,33 +137,38 @@ void ImProc::UpdateFrame()
 	if(!m_Video)
 		return;
 	//release the previous frame
+	ReleaseGrey(&m_PrevFrameGrey,m_PrevGreyIsView);
 	ReleaseImage(&m_PrevFrame);
+	ReleaseImage(&m_CurFrameColor);
 
-	//make the previous Frame this frame
-	if(m_CurFrame != 0) //safety
-		m_PrevFrame = cvCloneImage(m_CurFrame);
+	//make the previous Frame this frame, the grey copy comes along with it
+	m_PrevFrame = m_CurFrame;
+	m_PrevFrameGrey = m_CurFrameGrey;
+	m_PrevGreyIsView = m_CurGreyIsView;
+	m_CurFrame = 0;
+	m_CurFrameGrey = 0;
 
 	IplImage *Frame=cvQueryFrame(m_Video); // get a frame of video
-	//release the current frame of video before getting another
-	ReleaseImage(&m_CurFrame);
+	if(Frame == 0)
+		return;
 	//now copy a permanant copy of it into the current frame
 	m_CurFrame = cvCloneImage(Frame);
+	m_Layout = FrameLayout(m_CurFrame);
+	//for YUV and grey cameras this is just the luma plane, no conversion
+	m_CurFrameGrey = LumaImage(m_CurFrame,m_Layout,&m_CurGreyIsView);
 
-	if(m_PrevFrame == 0)
+	if(m_PrevFrameGrey == 0)
 		return; // we need to bail until we have 2 frames
-
-	//now convert this frame and the previous frame to grey
-	ReleaseImage(&m_CurFrameGrey);
-	m_CurFrameGrey  = ConvertToGrey(m_CurFrame);
 	IplImage * curgrey = m_CurFrameGrey;
+	IplImage * prevgrey = m_PrevFrameGrey;
 
 	if(m_ReferenceGrey == 0) // no reference image set yet
 		return;
 
-	IplImage * prevgrey = ConvertToGrey(m_PrevFrame);
-
 	//free and previous temporal image difference threshold picture
 	ReleaseImage(&m_TemporalImage);
+	for(int i = 0; i < IMPROC_MAX_PYRAMID; i++)
+		ReleaseImage(&m_TemporalPyramid[i]);
 	//and create a new one
 	m_TemporalImage = cvCreateImage(cvSize(curgrey->width,curgrey->height),curgrey->depth,1);
 
@@ -131,9 +181,9 @@ void ImProc::UpdateFrame()
 	refdat = (unsigned char *)m_ReferenceGrey->imageData; // get a pointer to the greyscale reference image
 	tmpdat = (unsigned char *)m_TemporalImage->imageData; // the temporal shadow difference image
 	//build a map of the min / max values 
-	for(int y =0 ; y < m_CurFrame->height; y ++)
+	for(int y =0 ; y < curgrey->height; y ++)
 	{
-		for(int x = 0; x < m_CurFrame->width; x++)
+		for(int x = 0; x < curgrey->width; x++)
 		{		
 			mindat = min(curdat[y * curgrey->widthStep + x],prvdat[y * prevgrey->widthStep + x]);
 			maxdat = max(curdat[y * curgrey->widthStep + x],prvdat[y * prevgrey->widthStep + x]);
@@ -148,9 +198,6 @@ void ImProc::UpdateFrame()
 			tmpdat[y * m_TemporalImage->widthStep + x] = (unsigned char)diff + offset;
 		}
 	}
-
-	//remember to clean up	
-	ReleaseImage(&prevgrey);
 }
 
 IplImage *ImProc::ConvertToGrey(IplImage *color)
@@ -159,4 +206,259 @@ IplImage *ImProc::ConvertToGrey(IplImage *color)
 	grey = cvCreateImage(cvSize(color->width,color->height),color->depth,1);
 	cvCvtColor(color, grey , CV_BGR2GRAY);
 	return grey;
-}
\ No newline at end of file
+}
+
+/*
+Work out what the camera handed back, drivers that ignore the
+raw format request still give us 3 channel BGR
+*/
+ePixelFormat ImProc::FrameLayout(IplImage *frame)
+{
+	if(frame->nChannels == 3)
+		return ePixelBGR;
+	if(frame->nChannels == 2)
+		return ePixelYUYV;
+	if(m_Format == ePixelNV12)
+		return ePixelNV12;
+	return ePixelGrey;
+}
+
+void ImProc::ReleaseGrey(IplImage **image,bool isview)
+{
+	if(*image == 0)
+		return;
+	if(isview)
+		cvReleaseImageHeader(image); // the data belongs to the frame
+	else
+		cvReleaseImage(image);
+	*image = 0;
+}
+
+/*
+Get the greyscale version of a frame
+grey and NV12 frames already start with the luma plane, so the
+grey image is just a header pointing into the frame (no copy)
+YUYV has the luma interleaved, it's pulled out 16 pixels at a time
+*/
+IplImage *ImProc::LumaImage(IplImage *frame,ePixelFormat layout,bool *isview)
+{
+	IplImage *grey;
+	*isview = false;
+	switch(layout)
+	{
+		case ePixelGrey:
+		case ePixelNV12:
+		{
+			//the NV12 frame is 1.5x the height, the UV plane follows the luma
+			int height = (layout == ePixelNV12) ? (frame->height * 2) / 3 : frame->height;
+			grey = cvCreateImageHeader(cvSize(frame->width,height),IPL_DEPTH_8U,1);
+			cvSetData(grey,frame->imageData,frame->widthStep);
+			*isview = true;
+			return grey;
+		}
+		case ePixelYUYV:
+		{
+			grey = cvCreateImage(cvSize(frame->width,frame->height),IPL_DEPTH_8U,1);
+			for(int y = 0; y < frame->height; y++)
+			{
+				unsigned char *src = (unsigned char *)frame->imageData + y * frame->widthStep;
+				unsigned char *out = (unsigned char *)grey->imageData + y * grey->widthStep;
+				int x = 0;
+#ifdef IMPROC_SSE
+				__m128i lowmask = _mm_set1_epi16(0x00ff);
+				for(; x + 16 <= frame->width; x += 16)
+				{
+					__m128i a = _mm_and_si128(_mm_loadu_si128((__m128i *)(src + 2 * x)),lowmask);
+					__m128i b = _mm_and_si128(_mm_loadu_si128((__m128i *)(src + 2 * x + 16)),lowmask);
+					_mm_storeu_si128((__m128i *)(out + x),_mm_packus_epi16(a,b));
+				}
+#endif
+				for(; x < frame->width; x++)
+					out[x] = src[2 * x];
+			}
+			return grey;
+		}
+		default:
+			return ConvertToGrey(frame);
+	}
+}
+
+static unsigned char ClampByte(int v)
+{
+	return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+/*
+Get the BGR color of a single pixel, converting from YUV (BT.601) if needed
+*/
+Color ImProc::FramePixel(IplImage *frame,ePixelFormat layout,int x,int y)
+{
+	Color tmp;
+	unsigned char *row = (unsigned char *)frame->imageData + y * frame->widthStep;
+	int Y,U,V;
+	switch(layout)
+	{
+		case ePixelBGR:
+			tmp.B = row[x * 3];
+			tmp.G = row[x * 3 + 1];
+			tmp.R = row[x * 3 + 2];
+			return tmp;
+		case ePixelGrey:
+			tmp.R = tmp.G = tmp.B = row[x];
+			return tmp;
+		case ePixelYUYV:
+		{
+			unsigned char *pair = row + (x & ~1) * 2; // Y0 U Y1 V
+			Y = row[x * 2];
+			U = pair[1];
+			V = pair[3];
+			break;
+		}
+		default: // NV12
+		{
+			int lumaheight = (frame->height * 2) / 3;
+			unsigned char *uv = (unsigned char *)frame->imageData + (lumaheight + y / 2) * frame->widthStep + (x & ~1);
+			Y = row[x];
+			U = uv[0];
+			V = uv[1];
+			break;
+		}
+	}
+	int c = 298 * (Y - 16);
+	int d = U - 128;
+	int e = V - 128;
+	tmp.R = ClampByte((c + 409 * e + 128) >> 8);
+	tmp.G = ClampByte((c - 100 * d - 208 * e + 128) >> 8);
+	tmp.B = ClampByte((c + 516 * d + 128) >> 8);
+	return tmp;
+}
+
+/*
+Make a BGR copy of a whole frame
+*/
+IplImage *ImProc::ConvertToColor(IplImage *frame,ePixelFormat layout)
+{
+	int height = (layout == ePixelNV12) ? (frame->height * 2) / 3 : frame->height;
+	IplImage *color = cvCreateImage(cvSize(frame->width,height),IPL_DEPTH_8U,3);
+	if(layout == ePixelGrey)
+	{
+		cvCvtColor(frame,color,CV_GRAY2BGR);
+		return color;
+	}
+	for(int y = 0; y < height; y++)
+	{
+		unsigned char *out = (unsigned char *)color->imageData + y * color->widthStep;
+		for(int x = 0; x < frame->width; x++)
+		{
+			Color c = FramePixel(frame,layout,x,y);
+			out[x * 3] = c.B;
+			out[x * 3 + 1] = c.G;
+			out[x * 3 + 2] = c.R;
+		}
+	}
+	return color;
+}
+
+/*
+The current frame in BGR, only converted when something needs the whole thing
+*/
+IplImage *ImProc::GetCurFrame()
+{
+	if(m_CurFrame == 0 || m_Layout == ePixelBGR)
+		return m_CurFrame;
+	if(m_CurFrameColor == 0)
+		m_CurFrameColor = ConvertToColor(m_CurFrame,m_Layout);
+	return m_CurFrameColor;
+}
+/*
+Return the temporal diff image downsampled by 2^level
+the levels are only built the first time they are asked for each frame
+*/
+IplImage *ImProc::GetTemporalPyramid(int level)
+{
+	if(m_TemporalImage == 0 || level < 1 || level > IMPROC_MAX_PYRAMID)
+		return 0;
+	IplImage *src = m_TemporalImage;
+	for(int i = 0; i < level; i++)
+	{
+		if(m_TemporalPyramid[i] == 0)
+		{
+			if(src->width < 2 || src->height < 2)
+				return 0;
+			m_TemporalPyramid[i] = cvCreateImage(cvSize(src->width / 2,src->height / 2),IPL_DEPTH_8U,1);
+			BoxDownsample(src,m_TemporalPyramid[i]);
+		}
+		src = m_TemporalPyramid[i];
+	}
+	return src;
+}
+
+/*
+2x2 box filter and decimate, 32 source pixels at a time with SSE2
+the rounding is done the same way as _mm_avg_epu8 (vertical pairs, then horizontal)
+so the scalar tail gives the same result
+*/
+void ImProc::BoxDownsample(IplImage *src,IplImage *dst)
+{
+	for(int y = 0; y < dst->height; y++)
+	{
+		unsigned char *r0 = (unsigned char *)src->imageData + (2 * y) * src->widthStep;
+		unsigned char *r1 = r0 + src->widthStep;
+		unsigned char *out = (unsigned char *)dst->imageData + y * dst->widthStep;
+		int x = 0;
+#ifdef IMPROC_SSE
+		__m128i lowmask = _mm_set1_epi16(0x00ff);
+		for(; x + 16 <= dst->width; x += 16)
+		{
+			__m128i a = _mm_avg_epu8(_mm_loadu_si128((__m128i *)(r0 + 2 * x)),_mm_loadu_si128((__m128i *)(r1 + 2 * x)));
+			__m128i b = _mm_avg_epu8(_mm_loadu_si128((__m128i *)(r0 + 2 * x + 16)),_mm_loadu_si128((__m128i *)(r1 + 2 * x + 16)));
+			//average the even and odd columns
+			a = _mm_avg_epu16(_mm_and_si128(a,lowmask),_mm_srli_epi16(a,8));
+			b = _mm_avg_epu16(_mm_and_si128(b,lowmask),_mm_srli_epi16(b,8));
+			_mm_storeu_si128((__m128i *)(out + x),_mm_packus_epi16(a,b));
+		}
+#endif
+		for(; x < dst->width; x++)
+		{
+			int left = (r0[2 * x] + r1[2 * x] + 1) >> 1;
+			int right = (r0[2 * x + 1] + r1[2 * x + 1] + 1) >> 1;
+			out[x] = (unsigned char)((left + right + 1) >> 1);
+		}
+	}
+}
+
+/*
+Batched color lookup, used once the points of a frame have been found
+The reference image is always BGR, and is only used if it matches the frame size
+*/
+void ImProc::GatherColors(const Point2D *pos,const unsigned char *mask,int n,Color *out,bool reference)
+{
+	IplImage *img = m_CurFrame;
+	ePixelFormat layout = m_Layout;
+	if(reference && m_Reference != 0 && m_CurFrameGrey != 0 &&
+		m_Reference->width == m_CurFrameGrey->width && m_Reference->height == m_CurFrameGrey->height)
+	{
+		img = m_Reference;
+		layout = ePixelBGR;
+	}
+	if(img == 0)
+		return;
+	if(layout != ePixelBGR)
+	{
+		for(int i = 0; i < n; i++)
+			if(mask == 0 || mask[i])
+				out[i] = FramePixel(img,layout,pos[i].X,pos[i].Y);
+		return;
+	}
+	unsigned char *data = (unsigned char *)img->imageData;
+	int widthstep = img->widthStep;
+	for(int i = 0; i < n; i++)
+	{
+		if(mask != 0 && !mask[i])
+			continue;
+		unsigned char *pix = data + (pos[i].Y * widthstep) + (pos[i].X * 3);
+		out[i].B = pix[0];
+		out[i].G = pix[1];
+		out[i].R = pix[2];
+	}
+}
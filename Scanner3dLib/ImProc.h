@@ -1,5 +1,10 @@
 #pragma once
 #include "scanner3dlib.h"
+#include "CaptureFormat.h"
+#include "Color.h"
+
+// the most levels of the diff image pyramid (level n is 1/2^n the size)
+#define IMPROC_MAX_PYRAMID 3
 
 // a set of tools used for image processing 
 // frames of video to be sent into the scanner library
@@ -10,18 +15,33 @@ class ImProc
 private:
 
 	CvCapture *m_Video;
-	IplImage* m_CurFrame; // the current frame (color)
+	ePixelFormat m_Format; // the format asked for in StartVideo
+	ePixelFormat m_Layout; // what the camera actually handed back for the current frame
+	IplImage* m_CurFrame; // the current frame, as delivered by the camera
+	IplImage* m_CurFrameColor; // BGR copy of a non BGR current frame, made on demand
 	IplImage* m_CurFrameGrey; // the current frame (grey)
-	IplImage* m_PrevFrame; // the previous frame of video (color)
+	IplImage* m_PrevFrame; // the previous frame of video, as delivered
+	IplImage* m_PrevFrameGrey; // the previous frame (grey)
+	bool m_CurGreyIsView; // the grey frames may just be headers over the luma plane of the frame
+	bool m_PrevGreyIsView;
 	IplImage* m_Reference; // the color reference image with no laser line
 	IplImage* m_ReferenceGrey; // the grey reference image with no laser line
 	IplImage* m_TemporalImage;// the greyscale diff image between 2 successive frames
+	IplImage* m_TemporalPyramid[IMPROC_MAX_PYRAMID];// downsampled copies of the diff image, built on demand
 
 	void ReleaseImage(IplImage **image);// called privately in this class
 	// the init is called by the constructor
 	void Init();
 	// the convert to greyscale image is private 
 	IplImage *ConvertToGrey(IplImage *color); 
+	// work out how a frame from the camera is laid out
+	ePixelFormat FrameLayout(IplImage *frame);
+	// the luma plane of a frame, isview is set if it shares the frame's data
+	IplImage *LumaImage(IplImage *frame,ePixelFormat layout,bool *isview);
+	void ReleaseGrey(IplImage **image,bool isview);
+	// color of one pixel of a frame in any layout
+	static Color FramePixel(IplImage *frame,ePixelFormat layout,int x,int y);
+	IplImage *ConvertToColor(IplImage *frame,ePixelFormat layout);
 
 	ImProc(void); // constructor is private
 public:
@@ -46,8 +66,8 @@ public:
 	void UpdateFrame();
 	// the reference image needs to be set for the algorithms to work
 	void SetRefImage();
-	//starting the video input
-	bool StartVideo(int camera = -1);
+	//starting the video input, fps = 0 leaves the camera default
+	bool StartVideo(int camera = -1,int width = 640,int height = 480,double fps = 0,ePixelFormat format = ePixelBGR);
 	//stopping the video input
 	void StopVideo();
 	bool VideoConnected()
@@ -61,8 +81,20 @@ public:
 	IplImage *GetReference(){return m_Reference;}
 	IplImage *GetReferenceGrey(){return m_ReferenceGrey;}
 
-	IplImage *GetCurFrame(){return m_CurFrame;}
+	// the current frame in BGR, for non BGR cameras this converts the whole frame
+	// the first time it's called for a frame, use GetColor for single pixels
+	IplImage *GetCurFrame();
+	IplImage *GetRawFrame(){return m_CurFrame;}
 	IplImage *GetCurFrameGrey(){return m_CurFrameGrey;}
 	IplImage *GetPrevFrame(){return m_PrevFrame;}
+	// color of a pixel in the current frame
+	Color GetColor(int x,int y){return FramePixel(m_CurFrame,m_Layout,x,y);}
+	// colors of n positions at once (skipping those with mask[i] == 0 if there is a mask)
+	// from the current frame, or the reference image if reference is set
+	void GatherColors(const Point2D *pos,const unsigned char *mask,int n,Color *out,bool reference);
 	IplImage *GetTemporalDiff(){return m_TemporalImage;}
+	// the diff image downsampled by 2^level (1 - IMPROC_MAX_PYRAMID)
+	IplImage *GetTemporalPyramid(int level);
+	// average each 2x2 block of the 8 bit src into dst (half the size)
+	static void BoxDownsample(IplImage *src,IplImage *dst);
 };
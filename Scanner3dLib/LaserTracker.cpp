@@ -0,0 +1,166 @@
+#include "LaserTracker.h"
+#include <math.h>
+
+LaserTracker::LaserTracker()
+{
+	m_processnoise = 1.0f;
+	m_measurementnoise = 1.0f;
+	m_bandscale = 3.0f;
+	m_minband = 4;
+	m_maxband = 32;
+	m_maxmissed = 3;
+	m_reacquire = 1;
+	m_minfoundratio = 0.5f;
+	m_tracks = 0;
+	m_numlines = 0;
+	m_linelength = 0;
+	m_frame = 0;
+	m_numtracked = 0;
+	m_bandsearched = 0;
+	m_bandfound = 0;
+}
+
+LaserTracker::~LaserTracker()
+{
+	delete []m_tracks;
+}
+
+/*
+Drop all of the tracks, the next frames will search in full
+*/
+void LaserTracker::Reset()
+{
+	for(int i = 0; i < m_numlines; i++)
+		m_tracks[i].missed = -1;
+	m_numtracked = 0;
+	m_frame = 0;
+}
+
+/*
+Start a new frame, the image size may change, in which case
+the tracks are thrown away. Every existing track is moved forward
+by its velocity and its uncertainty grows by the process noise.
+*/
+void LaserTracker::BeginFrame(int numlines,int linelength)
+{
+	if(numlines != m_numlines || linelength != m_linelength)
+	{
+		delete []m_tracks;
+		m_tracks = new LineTrack[numlines];
+		m_numlines = numlines;
+		m_linelength = linelength;
+		Reset();
+	}
+	float q = m_processnoise * m_processnoise;
+	for(int i = 0; i < m_numlines; i++)
+	{
+		LineTrack *t = &m_tracks[i];
+		if(t->missed == -1)
+			continue;
+		// x' = x + v, P' = F P F^t + Q
+		t->x += t->v;
+		t->p00 += 2 * t->p01 + t->p11 + q * 0.25f;
+		t->p01 += t->p11 + q * 0.5f;
+		t->p11 += q;
+	}
+	m_frame++;
+	m_bandsearched = 0;
+	m_bandfound = 0;
+}
+
+/*
+Determine how much of the line needs to be searched
+start and end are only set for eTrackBand, end is exclusive
+*/
+eTrackSearch LaserTracker::GetSearchRange(int line,int *start,int *end)
+{
+	if(line < 0 || line >= m_numlines)
+		return eTrackFull;
+	LineTrack *t = &m_tracks[line];
+	if(t->missed == -1)
+	{
+		//no track here, search it in full to pick the laser up
+		if(m_reacquire <= 1 || m_numtracked == 0 || ((line + m_frame) % m_reacquire) == 0)
+			return eTrackFull;
+		return eTrackSkip;
+	}
+	float var = t->p00 + m_measurementnoise * m_measurementnoise;
+	int band = (int)(m_bandscale * sqrtf(var) + 0.5f);
+	if(band < m_minband)
+		band = m_minband;
+	if(band > m_maxband)
+		band = m_maxband;
+	int center = (int)(t->x + 0.5f);
+	*start = center - band;
+	*end = center + band + 1;
+	if(*start < 0)
+		*start = 0;
+	if(*end > m_linelength)
+		*end = m_linelength;
+	if(*start >= *end)
+	{
+		//the prediction walked off the image
+		t->missed = -1;
+		m_numtracked--;
+		return eTrackFull;
+	}
+	m_bandsearched++;
+	return eTrackBand;
+}
+
+/*
+Feed back the result of searching a line, pos = -1 if the laser wasn't found
+*/
+void LaserTracker::Update(int line,int pos)
+{
+	if(line < 0 || line >= m_numlines)
+		return;
+	LineTrack *t = &m_tracks[line];
+	float r = m_measurementnoise * m_measurementnoise;
+	if(pos == -1)
+	{
+		if(t->missed != -1 && ++t->missed > m_maxmissed)
+		{
+			t->missed = -1;
+			m_numtracked--;
+		}
+		return;
+	}
+	if(t->missed == -1)
+	{
+		//start a new track, we know nothing about the velocity yet
+		t->x = (float)pos;
+		t->v = 0;
+		t->p00 = r;
+		t->p01 = 0;
+		t->p11 = (float)(m_maxband * m_maxband);
+		t->missed = 0;
+		m_numtracked++;
+		return;
+	}
+	m_bandfound++;
+	// standard Kalman update with H = [1 0]
+	float s = t->p00 + r;
+	float k0 = t->p00 / s;
+	float k1 = t->p01 / s;
+	float y = pos - t->x;
+	t->x += k0 * y;
+	t->v += k1 * y;
+	t->p11 -= k1 * t->p01;
+	t->p01 *= (1 - k0);
+	t->p00 *= (1 - k0);
+	t->missed = 0;
+}
+
+/*
+If the laser wasn't where we predicted on most of the lines,
+something jumped (the turntable skipped, the laser was switched etc.)
+throw the tracks away so the next frame does a full search.
+*/
+void LaserTracker::EndFrame()
+{
+	if(m_bandsearched == 0)
+		return;
+	if((float)m_bandfound < m_minfoundratio * m_bandsearched)
+		Reset();
+}
@@ -0,0 +1,62 @@
+#pragma once
+/*
+This class tracks the position of the laser on each scan line (a row for the
+single algorithm, a column for the corner algorithm) from frame to frame.
+During a sweep the laser moves smoothly, so each line gets a small constant
+velocity Kalman filter (position, velocity) that predicts where the laser
+will be in the next frame. The scanner then only has to search a narrow band
+around the prediction instead of the whole line.
+
+order of ops per frame:
+	BeginFrame - advances every track by one frame (the predict step)
+	GetSearchRange / Update - for each line that is searched
+	EndFrame - drops all tracks if too many of them missed the laser
+
+Lines without a track are searched in full every frame, so the laser is
+picked up as soon as it appears on a line (object edges, areas coming out
+of shadow). m_reacquire > 1 searches them only every m_reacquire frames
+(staggered across the lines), which is cheaper but misses those points.
+*/
+
+enum eTrackSearch
+{
+	eTrackSkip = 0, // don't search this line this frame
+	eTrackFull = 1, // search the whole line
+	eTrackBand = 2, // search only the returned band
+};
+
+class LaserTracker
+{
+public:
+	float m_processnoise; // how much the laser may accelerate between frames (pixels)
+	float m_measurementnoise; // jitter of the detected laser position (pixels)
+	float m_bandscale; // band half width in standard deviations of the prediction
+	int m_minband; // band half width limits in pixels
+	int m_maxband;
+	int m_maxmissed; // a track is dropped after this many frames without the laser
+	int m_reacquire; // untracked lines are searched in full every this many frames (1 = every frame)
+	float m_minfoundratio; // tracking is lost when fewer band searches than this find the laser
+
+	LaserTracker();
+	~LaserTracker();
+	void Reset();
+	void BeginFrame(int numlines,int linelength);
+	eTrackSearch GetSearchRange(int line,int *start,int *end);
+	void Update(int line,int pos);
+	void EndFrame();
+	bool IsTracking(){return m_numtracked > 0;}
+private:
+	struct LineTrack
+	{
+		float x,v; // predicted position and velocity
+		float p00,p01,p11; // covariance
+		int missed; // frames since the laser was last seen, -1 = no track
+	};
+	LineTrack *m_tracks;
+	int m_numlines;
+	int m_linelength;
+	int m_frame;
+	int m_numtracked;
+	int m_bandsearched; // band searches this frame
+	int m_bandfound; // band searches that found the laser this frame
+};
@@ -1,4 +1,6 @@
 #include "LeastSquares.h"
+#include <float.h>
+#include <cv.h>
 /* ------------------------------------------------------------------------
  * FILE: least-squares.c
  * This program computes a linear model for a set of given data.
@@ -26,7 +28,7 @@
  * REVISED: Steve Hernandez 12/20/2011 - converted to utility
  * ---------------------------------------------------------------------- */
 
-void FindLeastSquare(List *points, float *m, float *b)
+void FindLeastSquare(Array<Point2D *> *points, float *m, float *b)
 {
 	float SUMx = 0.0f;
 	float SUMy = 0.0f;
@@ -34,9 +36,9 @@ void FindLeastSquare(List *points, float *m, float *b)
 	float SUMxx = 0.0f;
 	float n = (float)(points->Count());
 	float slope,y_intercept;
-	for(ListItem *li = points->list; li!=0; li=li->next)
+	for(int c = 0; c < points->Count(); c++)
 	{
-		Point2D *p = (Point2D *)li->data;
+		Point2D *p = points->GetItem(c);
 		SUMx += p->X;
 		SUMy += p->Y;
 		SUMxy += p->X * p->Y;
@@ -47,4 +49,256 @@ void FindLeastSquare(List *points, float *m, float *b)
 	*m = slope;
 	*b = y_intercept;
 
-}
\ No newline at end of file
+}
+
+/*
+Least squares line over an array of points
+only the points with a non-zero mask are used (mask may be 0 to use all of them)
+*/
+void FindLeastSquare(Point2D *points, int n, unsigned char *mask, float *m, float *b)
+{
+	float SUMx = 0.0f;
+	float SUMy = 0.0f;
+	float SUMxy = 0.0f;
+	float SUMxx = 0.0f;
+	float cnt = 0.0f;
+	for(int i = 0; i < n; i++)
+	{
+		if(mask && !mask[i])
+			continue;
+		Point2D *p = &points[i];
+		SUMx += p->X;
+		SUMy += p->Y;
+		SUMxy += p->X * p->Y;
+		SUMxx += p->X * p->X;
+		cnt += 1.0f;
+	}
+	*m = ( SUMx*SUMy - cnt*SUMxy ) / ( SUMx*SUMx - cnt*SUMxx ) ;
+	*b = ( SUMy - *m*SUMx ) / cnt;
+}
+
+/*
+Least squares plane over an array of points
+the normal is the eigenvector of the scatter matrix with the smallest eigenvalue
+only the points with a non-zero mask are used (mask may be 0 to use all of them)
+*/
+void FindLeastSquarePlane(point_3d *points, int n, unsigned char *mask, Plane *pl)
+{
+	double cx = 0, cy = 0, cz = 0, cnt = 0;
+	for(int i = 0; i < n; i++)
+	{
+		if(mask && !mask[i])
+			continue;
+		cx += points[i].Wx;
+		cy += points[i].Wy;
+		cz += points[i].Wz;
+		cnt += 1;
+	}
+	cx /= cnt; cy /= cnt; cz /= cnt;
+	double scatter[9] = {0,0,0,0,0,0,0,0,0};
+	for(int i = 0; i < n; i++)
+	{
+		if(mask && !mask[i])
+			continue;
+		double d[3] = {points[i].Wx - cx, points[i].Wy - cy, points[i].Wz - cz};
+		for(int r = 0; r < 3; r++)
+			for(int c = 0; c < 3; c++)
+				scatter[r*3 + c] += d[r]*d[c];
+	}
+	double evects[9], evals[3];
+	CvMat matscatter = cvMat(3,3,CV_64FC1,scatter);
+	CvMat matevects = cvMat(3,3,CV_64FC1,evects);
+	CvMat matevals = cvMat(3,1,CV_64FC1,evals);
+	cvEigenVV(&matscatter,&matevects,&matevals,DBL_EPSILON);
+	// eigenvalues are in descending order, so the normal is the last row
+	pl->a = (float)evects[6];
+	pl->b = (float)evects[7];
+	pl->c = (float)evects[8];
+	pl->d = (float)-(evects[6]*cx + evects[7]*cy + evects[8]*cz);
+}
+
+// a small deterministic generator, so fits are repeatable frame to frame
+static unsigned int RansacRand(unsigned int *seed)
+{
+	*seed = (*seed * 1103515245u) + 12345u;
+	return (*seed >> 16) & 0x7fff;
+}
+
+// shuffle the order that points are scored in (preemptive scoring works on blocks of points)
+static void RansacOrder(int *order, int n, unsigned int *seed)
+{
+	for(int i = 0; i < n; i++)
+		order[i] = i;
+	for(int i = n - 1; i > 0; i--)
+	{
+		int j = RansacRand(seed) % (i + 1);
+		int tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+	}
+}
+
+// sort the active hypotheses by score (descending), there are only a handful of them
+static void RansacSort(int *hyp, int *score, int active)
+{
+	for(int i = 1; i < active; i++)
+	{
+		for(int j = i; j > 0 && score[hyp[j]] > score[hyp[j-1]]; j--)
+		{
+			int tmp = hyp[j]; hyp[j] = hyp[j-1]; hyp[j-1] = tmp;
+		}
+	}
+}
+
+#define RANSAC_BLOCK 8 // number of points scored before the hypotheses are halved
+
+static float LineResidual(Point2D *p, float m, float b)
+{
+	return (float)fabs(p->Y - ((m * p->X) + b));
+}
+
+float FindRobustLine(Point2D *points, int n, float tolerance, int iterations, float *m, float *b)
+{
+	if(n < 2)
+		return 0.0f;
+	unsigned int seed = 1;
+	float *hm = new float[iterations];
+	float *hb = new float[iterations];
+	int *score = new int[iterations];
+	int *hyp = new int[iterations];
+	int *order = new int[n];
+	unsigned char *inliers = new unsigned char[n];
+	//generate all of the hypotheses up front from random pairs of points
+	int numhyp = 0;
+	for(int i = 0; i < iterations; i++)
+	{
+		Point2D *p1 = &points[RansacRand(&seed) % n];
+		Point2D *p2 = &points[RansacRand(&seed) % n];
+		if(p1->X == p2->X)
+			continue; // degenerate sample
+		hm[numhyp] = (float)(p2->Y - p1->Y) / (float)(p2->X - p1->X);
+		hb[numhyp] = p1->Y - (hm[numhyp] * p1->X);
+		score[numhyp] = 0;
+		hyp[numhyp] = numhyp;
+		numhyp++;
+	}
+	if(numhyp == 0)
+	{
+		//every sample was degenerate, fall back to a plain fit
+		FindLeastSquare(points,n,0,m,b);
+	}
+	else
+	{
+		//score the hypotheses on blocks of points, keeping the better half after each block
+		RansacOrder(order,n,&seed);
+		int active = numhyp;
+		for(int start = 0; start < n && active > 1; start += RANSAC_BLOCK)
+		{
+			for(int h = 0; h < active; h++)
+				for(int i = start; i < n && i < start + RANSAC_BLOCK; i++)
+					if(LineResidual(&points[order[i]],hm[hyp[h]],hb[hyp[h]]) <= tolerance)
+						score[hyp[h]]++;
+			RansacSort(hyp,score,active);
+			active = (active + 1) / 2;
+		}
+		*m = hm[hyp[0]];
+		*b = hb[hyp[0]];
+	}
+	//refit on the inliers of the best hypothesis, then count the inliers of the refit
+	int count = 0;
+	for(int i = 0; i < n; i++)
+	{
+		inliers[i] = LineResidual(&points[i],*m,*b) <= tolerance;
+		count += inliers[i];
+	}
+	if(count >= 2)
+	{
+		FindLeastSquare(points,n,inliers,m,b);
+		count = 0;
+		for(int i = 0; i < n; i++)
+			count += (LineResidual(&points[i],*m,*b) <= tolerance);
+	}
+	delete []hm;
+	delete []hb;
+	delete []score;
+	delete []hyp;
+	delete []order;
+	delete []inliers;
+	return (float)count / (float)n;
+}
+
+static float PlaneResidual(point_3d *p, Plane *pl)
+{
+	return (float)fabs((pl->a * p->Wx) + (pl->b * p->Wy) + (pl->c * p->Wz) + pl->d);
+}
+
+float FindRobustPlane(point_3d *points, int n, float tolerance, int iterations, Plane *pl)
+{
+	if(n < 3)
+		return 0.0f;
+	unsigned int seed = 1;
+	Plane *hp = new Plane[iterations];
+	int *score = new int[iterations];
+	int *hyp = new int[iterations];
+	int *order = new int[n];
+	unsigned char *inliers = new unsigned char[n];
+	//generate all of the hypotheses up front from random triples of points
+	int numhyp = 0;
+	for(int i = 0; i < iterations; i++)
+	{
+		point_3d *p1 = &points[RansacRand(&seed) % n];
+		point_3d *p2 = &points[RansacRand(&seed) % n];
+		point_3d *p3 = &points[RansacRand(&seed) % n];
+		float ux = p2->Wx - p1->Wx, uy = p2->Wy - p1->Wy, uz = p2->Wz - p1->Wz;
+		float vx = p3->Wx - p1->Wx, vy = p3->Wy - p1->Wy, vz = p3->Wz - p1->Wz;
+		float nx = (uy * vz) - (uz * vy);
+		float ny = (uz * vx) - (ux * vz);
+		float nz = (ux * vy) - (uy * vx);
+		float len = (float)sqrt((nx*nx) + (ny*ny) + (nz*nz));
+		if(len < 1e-6f)
+			continue; // degenerate (colinear) sample
+		hp[numhyp].Set(nx/len,ny/len,nz/len,-((nx*p1->Wx) + (ny*p1->Wy) + (nz*p1->Wz))/len);
+		score[numhyp] = 0;
+		hyp[numhyp] = numhyp;
+		numhyp++;
+	}
+	if(numhyp == 0)
+	{
+		//every sample was degenerate, fall back to a plain fit
+		FindLeastSquarePlane(points,n,0,pl);
+	}
+	else
+	{
+		//score the hypotheses on blocks of points, keeping the better half after each block
+		RansacOrder(order,n,&seed);
+		int active = numhyp;
+		for(int start = 0; start < n && active > 1; start += RANSAC_BLOCK)
+		{
+			for(int h = 0; h < active; h++)
+				for(int i = start; i < n && i < start + RANSAC_BLOCK; i++)
+					if(PlaneResidual(&points[order[i]],&hp[hyp[h]]) <= tolerance)
+						score[hyp[h]]++;
+			RansacSort(hyp,score,active);
+			active = (active + 1) / 2;
+		}
+		*pl = hp[hyp[0]];
+	}
+	//refit on the inliers of the best hypothesis, then count the inliers of the refit
+	int count = 0;
+	for(int i = 0; i < n; i++)
+	{
+		inliers[i] = PlaneResidual(&points[i],pl) <= tolerance;
+		count += inliers[i];
+	}
+	if(count >= 3)
+	{
+		FindLeastSquarePlane(points,n,inliers,pl);
+		count = 0;
+		for(int i = 0; i < n; i++)
+			count += (PlaneResidual(&points[i],pl) <= tolerance);
+	}
+	delete []hp;
+	delete []score;
+	delete []hyp;
+	delete []order;
+	delete []inliers;
+	return (float)count / (float)n;
+}
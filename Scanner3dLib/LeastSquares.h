@@ -31,6 +31,18 @@
 #include <math.h>
 #include <stdio.h>
 #include "point3d.hpp"
-#include "listitem.h"
-void FindLeastSquare(List *points, float *m, float *b);
+#include "Array.h"
+#include "plane.h"
+void FindLeastSquare(Array<Point2D *> *points, float *m, float *b);
+void FindLeastSquare(Point2D *points, int n, unsigned char *mask, float *m, float *b);
+void FindLeastSquarePlane(point_3d *points, int n, unsigned char *mask, Plane *pl);
+/*
+ * Robust versions of the above, these use preemptive RANSAC with a fixed
+ * number of hypotheses (so the runtime is bounded), then refit with least
+ * squares on the inliers. tolerance is the maximum residual for an inlier
+ * (vertical distance in pixels for lines, distance in world units for planes)
+ * Both return the inlier ratio (0 - 1) of the final fit.
+ */
+float FindRobustLine(Point2D *points, int n, float tolerance, int iterations, float *m, float *b);
+float FindRobustPlane(point_3d *points, int n, float tolerance, int iterations, Plane *pl);
 #endif
\ No newline at end of file
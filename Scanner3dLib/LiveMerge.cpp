@@ -0,0 +1,80 @@
+#include "LiveMerge.h"
+#include <string.h>
+
+LiveMerge::LiveMerge()
+{
+	m_grid = 0;
+	m_width = 0;
+	m_height = 0;
+	m_numframes = 0;
+	m_numpoints = 0;
+	m_numpixels = 0;
+}
+
+LiveMerge::~LiveMerge()
+{
+	delete []m_grid;
+}
+
+void LiveMerge::Resize(int width,int height)
+{
+	if(width == m_width && height == m_height)
+		return;
+	delete []m_grid;
+	m_grid = 0;
+	m_width = width;
+	m_height = height;
+	if(width > 0 && height > 0)
+		m_grid = new PixelSum[width * height];
+	Clear();
+}
+
+void LiveMerge::Clear()
+{
+	if(m_grid != 0)
+		memset(m_grid,0,sizeof(PixelSum) * m_width * m_height);
+	m_numframes = 0;
+	m_numpoints = 0;
+	m_numpixels = 0;
+}
+
+void LiveMerge::AddFrame(ScannerFrame *sf)
+{
+	m_numframes++;
+	if(m_grid == 0)
+		return;
+	for(int p = 0; p < sf->m_pPoints->Count(); p++)
+	{
+		point_3d *pnt = sf->m_pPoints->GetItem(p);
+		int px = pnt->m_p2d.X,py = pnt->m_p2d.Y;
+		if(px < 0 || py < 0 || px >= m_width || py >= m_height)
+			continue;
+		PixelSum *ps = &m_grid[py * m_width + px];
+		if(ps->count == 0)
+			m_numpixels++;
+		unsigned int rgb = ((unsigned int)pnt->m_color.R << 16) | ((unsigned int)pnt->m_color.G << 8) | pnt->m_color.B;
+		ps->Add(pnt->Wx,pnt->Wy,pnt->Wz,pnt->m_weight,rgb);
+		m_numpoints++;
+	}
+}
+
+int LiveMerge::Snapshot(ScanPoint *out,float *variance)
+{
+	int num = 0;
+	for(int c = 0; c < m_width * m_height && num < m_numpixels; c++)
+	{
+		PixelSum *ps = &m_grid[c];
+		if(ps->count == 0)
+			continue;
+		if(variance != 0)
+			variance[num] = ps->Variance();
+		ScanPoint *newpnt = &out[num++];
+		newpnt->x = (float)ps->x;
+		newpnt->y = (float)ps->y;
+		newpnt->z = (float)ps->z;
+		newpnt->rgb = ps->rgb;
+		newpnt->pixel = ScanPoint::PackPixel(c % m_width,c / m_width);
+		newpnt->weight = (float)ps->weight;
+	}
+	return num;
+}
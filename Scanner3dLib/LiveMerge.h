@@ -0,0 +1,78 @@
+#pragma once
+#include "Array.h"
+#include "ScannerFrame.h"
+#include "ScanPoint.h"
+/*
+The per pixel merge of PostProcessor::MergePoints, kept up to date as the
+frames come in instead of being worked out from all the frames at save time.
+ScannerAlg::CollectFrames adds each new frame to a grid of running sums
+the size of the image, so the cost of a frame is the cost of its points,
+and getting the merged scan is one pass over the grid however long the
+scan has been running.
+
+Each pixel is a weighted running mean of its points (West 1979), the
+weights are the points' confidence from the detector (ScanPoint::weight).
+Along with the mean it keeps the weighted spread of the points about it,
+and the color of the most trusted point.
+*/
+class LiveMerge
+{
+public:
+	struct PixelSum
+	{
+		double x,y,z; // weighted mean
+		double weight; // sum of the weights
+		double spread; // sum of weight * squared distance from the mean
+		float bestweight; // of the point the color came from
+		int count; // 0 = nothing seen at this pixel yet
+		unsigned int rgb;
+
+		void Add(float px,float py,float pz,float w,unsigned int color)
+		{
+			if(w <= 0)
+				w = 1e-6f; // still counts, just barely
+			double total = weight + w;
+			double dx = px - x,dy = py - y,dz = pz - z;
+			double r = w / total;
+			x += dx * r;
+			y += dy * r;
+			z += dz * r;
+			spread += weight * r * (dx * dx + dy * dy + dz * dz);
+			weight = total;
+			if(count++ == 0 || w >= bestweight)
+			{
+				bestweight = w;
+				rgb = color;
+			}
+		}
+		// weighted variance of the distance from the mean, mm^2
+		float Variance(){return weight > 0 ? (float)(spread / weight) : 0.0f;}
+	};
+
+	LiveMerge();
+	~LiveMerge();
+	// sets the image size, the sums are cleared if it changes
+	void Resize(int width,int height);
+	void Clear();
+	void AddFrame(ScannerFrame *sf);
+	/*
+	the merged points in pixel order, out needs room for NumPixels() points,
+	each point's weight is the sum of the weights merged into it.
+	variance is optional, one per point, see PixelSum::Variance
+	*/
+	int Snapshot(ScanPoint *out,float *variance = 0);
+	// the running sums, width * height of them, for previews
+	const PixelSum *Grid(){return m_grid;}
+	int Width(){return m_width;}
+	int Height(){return m_height;}
+	int NumFrames(){return m_numframes;}
+	int NumPoints(){return m_numpoints;}
+	int NumPixels(){return m_numpixels;} // pixels with at least one point
+private:
+	PixelSum *m_grid;
+	int m_width;
+	int m_height;
+	int m_numframes;
+	int m_numpoints;
+	int m_numpixels;
+};
@@ -0,0 +1,210 @@
+#include "NormalEstimator.h"
+#include "SpatialHash.h"
+#include <math.h>
+#include <string.h>
+
+NormalEstimator::NormalEstimator()
+{
+	m_maxedge = 5.0f;
+	m_k = 12;
+	m_viewx = 0;
+	m_viewy = 0;
+	m_viewz = 0;
+}
+
+// the normals are flipped to face this point, normally the camera position
+void NormalEstimator::SetViewpoint(float x,float y,float z)
+{
+	m_viewx = x;
+	m_viewy = y;
+	m_viewz = z;
+}
+
+void NormalEstimator::Orient(ScanPoint *p,float *n)
+{
+	float d = (m_viewx - p->x) * n[0] + (m_viewy - p->y) * n[1] + (m_viewz - p->z) * n[2];
+	if(d < 0)
+	{
+		n[0] = -n[0];
+		n[1] = -n[1];
+		n[2] = -n[2];
+	}
+}
+
+/*
+The eigenvalues of a symmetric 3x3 come from the trigonometric solution of
+its characteristic cubic (Smith 1961), no iterating. The eigenvector is then
+the largest cross product of two rows of (A - lambda I), those rows all
+lie in the plane perpendicular to it.
+*/
+bool NormalEstimator::SmallestEigenvector(double *cov,float *n)
+{
+	double a00 = cov[0],a01 = cov[1],a02 = cov[2],a11 = cov[3],a12 = cov[4],a22 = cov[5];
+	double q = (a00 + a11 + a22) / 3;
+	double p1 = a01 * a01 + a02 * a02 + a12 * a12;
+	double p2 = (a00 - q) * (a00 - q) + (a11 - q) * (a11 - q) + (a22 - q) * (a22 - q) + 2 * p1;
+	double p = sqrt(p2 / 6);
+	if(p < 1e-12)
+		return false; // all eigenvalues the same, no preferred direction
+	double b00 = (a00 - q) / p,b11 = (a11 - q) / p,b22 = (a22 - q) / p;
+	double b01 = a01 / p,b02 = a02 / p,b12 = a12 / p;
+	double r = (b00 * (b11 * b22 - b12 * b12) - b01 * (b01 * b22 - b12 * b02) + b02 * (b01 * b12 - b11 * b02)) / 2;
+	if(r < -1) r = -1;
+	if(r > 1) r = 1;
+	double phi = acos(r) / 3;
+	double lambda = q + 2 * p * cos(phi + 2.0943951023931953); // + 2pi/3 gives the smallest
+
+	double r0[3] = {a00 - lambda,a01,a02};
+	double r1[3] = {a01,a11 - lambda,a12};
+	double r2[3] = {a02,a12,a22 - lambda};
+	double c[3][3];
+	c[0][0] = r0[1] * r1[2] - r0[2] * r1[1];
+	c[0][1] = r0[2] * r1[0] - r0[0] * r1[2];
+	c[0][2] = r0[0] * r1[1] - r0[1] * r1[0];
+	c[1][0] = r0[1] * r2[2] - r0[2] * r2[1];
+	c[1][1] = r0[2] * r2[0] - r0[0] * r2[2];
+	c[1][2] = r0[0] * r2[1] - r0[1] * r2[0];
+	c[2][0] = r1[1] * r2[2] - r1[2] * r2[1];
+	c[2][1] = r1[2] * r2[0] - r1[0] * r2[2];
+	c[2][2] = r1[0] * r2[1] - r1[1] * r2[0];
+	int best = 0;
+	double bestlen = 0;
+	for(int i = 0; i < 3; i++)
+	{
+		double len = c[i][0] * c[i][0] + c[i][1] * c[i][1] + c[i][2] * c[i][2];
+		if(len > bestlen)
+		{
+			bestlen = len;
+			best = i;
+		}
+	}
+	if(bestlen < 1e-24)
+		return false;
+	double inv = 1.0 / sqrt(bestlen);
+	n[0] = (float)(c[best][0] * inv);
+	n[1] = (float)(c[best][1] * inv);
+	n[2] = (float)(c[best][2] * inv);
+	return true;
+}
+
+/*
+Central differences where both neighbours are there, one sided where only
+one is, nothing if neither is.
+*/
+void NormalEstimator::GridNormals(ScanPoint *pnts,int numpnts,int width,int height,float *normals)
+{
+	memset(normals,0,sizeof(float) * 3 * numpnts);
+	int *grid = new int[width * height];
+	memset(grid,0xff,sizeof(int) * width * height); // all -1
+	for(int i = 0; i < numpnts; i++)
+	{
+		int px = pnts[i].PixelX(),py = pnts[i].PixelY();
+		if(px < width && py < height)
+			grid[py * width + px] = i;
+	}
+	float max2 = m_maxedge * m_maxedge;
+	int y;
+#pragma omp parallel for schedule(dynamic,16)
+	for(y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			int c = grid[y * width + x];
+			if(c == -1)
+				continue;
+			ScanPoint *p = &pnts[c];
+			// the usable neighbour on each side, or the point itself
+			ScanPoint *side[4]; // left, right, up, down
+			int dx[4] = {-1,1,0,0};
+			int dy[4] = {0,0,-1,1};
+			for(int s = 0; s < 4; s++)
+			{
+				side[s] = p;
+				int nx = x + dx[s],ny = y + dy[s];
+				if(nx < 0 || ny < 0 || nx >= width || ny >= height)
+					continue;
+				int ni = grid[ny * width + nx];
+				if(ni == -1)
+					continue;
+				ScanPoint *q = &pnts[ni];
+				float ex = q->x - p->x,ey = q->y - p->y,ez = q->z - p->z;
+				if(ex * ex + ey * ey + ez * ez <= max2)
+					side[s] = q;
+			}
+			if((side[0] == p && side[1] == p) || (side[2] == p && side[3] == p))
+				continue;
+			float u[3] = {side[1]->x - side[0]->x,side[1]->y - side[0]->y,side[1]->z - side[0]->z};
+			float v[3] = {side[3]->x - side[2]->x,side[3]->y - side[2]->y,side[3]->z - side[2]->z};
+			float *n = &normals[c * 3];
+			n[0] = u[1] * v[2] - u[2] * v[1];
+			n[1] = u[2] * v[0] - u[0] * v[2];
+			n[2] = u[0] * v[1] - u[1] * v[0];
+			float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if(len <= 0)
+			{
+				n[0] = n[1] = n[2] = 0;
+				continue;
+			}
+			n[0] /= len;
+			n[1] /= len;
+			n[2] /= len;
+			Orient(p,n);
+		}
+	}
+	delete []grid;
+}
+
+void NormalEstimator::PCANormals(ScanPoint *pnts,int numpnts,float *normals)
+{
+	memset(normals,0,sizeof(float) * 3 * numpnts);
+	if(numpnts < 3)
+		return;
+	SpatialHash hash;
+	hash.BuildAdaptive(pnts,numpnts,m_k);
+	int k = m_k;
+#pragma omp parallel
+	{
+		int *idx = new int[k];
+		float *dist2 = new float[k];
+#pragma omp for schedule(dynamic,1024)
+		for(int i = 0; i < numpnts; i++)
+		{
+			int c = hash.Item(i); // in bucket order, see SpatialHash
+			ScanPoint *p = &pnts[c];
+			int found = hash.Nearest(p->x,p->y,p->z,k,-1,idx,dist2);
+			if(found < 3)
+				continue;
+			// covariance about the mean, relative to p to keep the numbers small
+			double mx = 0,my = 0,mz = 0;
+			double cov[6] = {0,0,0,0,0,0};
+			for(int j = 0; j < found; j++)
+			{
+				ScanPoint *q = &pnts[idx[j]];
+				double x = q->x - p->x,y = q->y - p->y,z = q->z - p->z;
+				mx += x;
+				my += y;
+				mz += z;
+				cov[0] += x * x;
+				cov[1] += x * y;
+				cov[2] += x * z;
+				cov[3] += y * y;
+				cov[4] += y * z;
+				cov[5] += z * z;
+			}
+			mx /= found;
+			my /= found;
+			mz /= found;
+			cov[0] = cov[0] / found - mx * mx;
+			cov[1] = cov[1] / found - mx * my;
+			cov[2] = cov[2] / found - mx * mz;
+			cov[3] = cov[3] / found - my * my;
+			cov[4] = cov[4] / found - my * mz;
+			cov[5] = cov[5] / found - mz * mz;
+			float *n = &normals[c * 3];
+			if(SmallestEigenvector(cov,n))
+				Orient(p,n);
+		}
+		delete []idx;
+		delete []dist2;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "ScanPoint.h"
+/*
+Estimates a surface normal for every point, so the exporters can write them
+and surface reconstruction doesn't have to work them out again.
+The normals go in a separate float array, 3 per point (nx,ny,nz),
+parallel to the points, so ScanPoint stays small.
+
+GridNormals - for organized scans (at most one point per pixel, as
+	PostProcessor::MergePoints makes), the neighbours come straight from the
+	pixel grid: the normal is the cross product of the horizontal and vertical
+	differences. Neighbours further than m_maxedge away are across a depth
+	discontinuity and aren't used.
+PCANormals - for any cloud, the normal is the direction of least spread of
+	the m_k nearest points (found with a SpatialHash), the eigenvector of the
+	smallest eigenvalue of their covariance, solved in closed form.
+
+Both run in parallel (OpenMP). The normals are turned to face the viewpoint.
+Points without enough neighbours get a 0,0,0 normal.
+*/
+class NormalEstimator
+{
+public:
+	float m_maxedge; // GridNormals, world units (mm)
+	int m_k; // PCANormals neighbourhood size
+
+	NormalEstimator();
+	void SetViewpoint(float x,float y,float z);
+	void GridNormals(ScanPoint *pnts,int numpnts,int width,int height,float *normals);
+	void PCANormals(ScanPoint *pnts,int numpnts,float *normals);
+
+	// the unit eigenvector of the smallest eigenvalue of the symmetric matrix
+	// xx xy xz yy yz zz, false if it's degenerate
+	static bool SmallestEigenvector(double *cov,float *n);
+private:
+	float m_viewx,m_viewy,m_viewz;
+	void Orient(ScanPoint *p,float *n);
+};
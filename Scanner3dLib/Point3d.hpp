@@ -52,6 +52,7 @@ public:
 	float			 Cx,Cy,Cz;// camera coords
 	Color	 m_color; // the original unlit color
 	Point2D  m_p2d; // the 2d screen point this originally came from
+	float	 m_weight; // how much the point is trusted when merging (1 = plain average)
     int operator == (point_3d &test){
 		if((Wx == test.Wx) && (Wy == test.Wy) && (Wz == test.Wz))
               {return 1;}else 
@@ -67,11 +68,13 @@ public:
     point_3d(){
 		Wx= 0.0f;Wy=0.0f;Wz=0.0f;
 		Cx= 0.0f;Cy=0.0f;Cz=0.0f;
+		m_weight = 1.0f;
 	}
     point_3d(float x,float y,float z)
 	{
 		Wx= x;Wy=y;Wz=z;
 		Cx= 0.0f;Cy=0.0f;Cz=0.0f;
+		m_weight = 1.0f;
 	}
 	void Project(Point2D &p); 
 	void Project(Point2D &temp,camera *cam,int wid,int hei);
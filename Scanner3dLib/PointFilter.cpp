@@ -0,0 +1,228 @@
+#include "PointFilter.h"
+#include "SpatialHash.h"
+#include <math.h>
+#include <string.h>
+
+PointFilter::PointFilter()
+{
+	m_mindepth = 0;
+	m_maxdepth = 0;
+	m_radius = 0;
+	m_minneighbors = 4;
+	m_statk = 0;
+	m_statstddev = 3.0f;
+	m_voxelsize = 0;
+	m_viewx = 0;
+	m_viewy = 0;
+	m_viewz = 0;
+}
+
+// where the depth is measured from, normally the camera position
+void PointFilter::SetViewpoint(float x,float y,float z)
+{
+	m_viewx = x;
+	m_viewy = y;
+	m_viewz = z;
+}
+
+int PointFilter::Run(ScanPoint *pnts,int numpnts)
+{
+	numpnts = ClipDepth(pnts,numpnts);
+	numpnts = RemoveRadiusOutliers(pnts,numpnts);
+	numpnts = RemoveStatisticalOutliers(pnts,numpnts);
+	numpnts = VoxelDownsample(pnts,numpnts);
+	return numpnts;
+}
+
+// move the kept points down over the removed ones
+int PointFilter::Compact(ScanPoint *pnts,int numpnts,unsigned char *keep)
+{
+	int num = 0;
+	for(int c = 0; c < numpnts; c++)
+	{
+		if(keep[c])
+			pnts[num++] = pnts[c];
+	}
+	return num;
+}
+
+int PointFilter::ClipDepth(ScanPoint *pnts,int numpnts)
+{
+	if(m_maxdepth <= 0)
+		return numpnts;
+	float min2 = m_mindepth * m_mindepth;
+	float max2 = m_maxdepth * m_maxdepth;
+	int num = 0;
+	for(int c = 0; c < numpnts; c++)
+	{
+		float dx = pnts[c].x - m_viewx;
+		float dy = pnts[c].y - m_viewy;
+		float dz = pnts[c].z - m_viewz;
+		float d2 = dx * dx + dy * dy + dz * dz;
+		if(d2 >= min2 && d2 <= max2)
+			pnts[num++] = pnts[c];
+	}
+	return num;
+}
+
+int PointFilter::RemoveRadiusOutliers(ScanPoint *pnts,int numpnts)
+{
+	if(m_radius <= 0 || numpnts == 0)
+		return numpnts;
+	SpatialHash hash;
+	hash.Build(pnts,numpnts,m_radius);
+	unsigned char *keep = new unsigned char[numpnts];
+	int need = m_minneighbors + 1; // the point finds itself too
+#pragma omp parallel for schedule(dynamic,1024)
+	for(int i = 0; i < numpnts; i++)
+	{
+		int c = hash.Item(i); // in bucket order, see SpatialHash
+		keep[c] = hash.CountWithin(pnts[c].x,pnts[c].y,pnts[c].z,m_radius,need) >= need;
+	}
+	numpnts = Compact(pnts,numpnts,keep);
+	delete []keep;
+	return numpnts;
+}
+
+int PointFilter::RemoveStatisticalOutliers(ScanPoint *pnts,int numpnts)
+{
+	if(m_statk <= 0 || numpnts <= m_statk)
+		return numpnts;
+	SpatialHash hash;
+	hash.BuildAdaptive(pnts,numpnts,m_statk);
+	float *meandist = new float[numpnts];
+	int k = m_statk;
+#pragma omp parallel
+	{
+		int *idx = new int[k];
+		float *dist2 = new float[k];
+#pragma omp for schedule(dynamic,1024)
+		for(int i = 0; i < numpnts; i++)
+		{
+			int c = hash.Item(i);
+			int found = hash.Nearest(pnts[c].x,pnts[c].y,pnts[c].z,k,c,idx,dist2);
+			if(found == 0)
+			{
+				meandist[c] = -1; // nothing anywhere near it
+				continue;
+			}
+			float sum = 0;
+			for(int j = 0; j < found; j++)
+				sum += sqrtf(dist2[j]);
+			meandist[c] = sum / found;
+		}
+		delete []idx;
+		delete []dist2;
+	}
+	//summed in order so the threshold is the same however many threads ran
+	double sum = 0,sum2 = 0;
+	int num = 0;
+	for(int c = 0; c < numpnts; c++)
+	{
+		if(meandist[c] < 0)
+			continue;
+		sum += meandist[c];
+		sum2 += (double)meandist[c] * meandist[c];
+		num++;
+	}
+	double mean = num > 0 ? sum / num : 0;
+	double var = num > 0 ? sum2 / num - mean * mean : 0;
+	float threshold = (float)(mean + m_statstddev * sqrt(var > 0 ? var : 0));
+	unsigned char *keep = new unsigned char[numpnts];
+	for(int c = 0; c < numpnts; c++)
+		keep[c] = meandist[c] >= 0 && meandist[c] <= threshold;
+	numpnts = Compact(pnts,numpnts,keep);
+	delete []keep;
+	delete []meandist;
+	return numpnts;
+}
+
+/*
+Each bucket of the hash is handled on its own, a bucket can hold more than one
+voxel so the points are grouped by cell inside it. Like the GridMesher the
+voxels are counted first so every bucket knows where its output goes.
+The result is ordered by bucket, the position and color are averaged,
+the pixel is the first point's.
+*/
+int PointFilter::VoxelDownsample(ScanPoint *pnts,int numpnts)
+{
+	if(m_voxelsize <= 0 || numpnts == 0)
+		return numpnts;
+	SpatialHash hash;
+	hash.Build(pnts,numpnts,m_voxelsize);
+	int numbuckets = hash.NumBuckets();
+	int *offset = new int[numbuckets + 1];
+	// a point leads its voxel if no earlier point in the bucket is in the same cell
+	unsigned char *leader = new unsigned char[numpnts];
+#pragma omp parallel for schedule(dynamic,4096)
+	for(int b = 0; b < numbuckets; b++)
+	{
+		int count = 0;
+		for(int i = hash.BucketStart(b); i < hash.BucketEnd(b); i++)
+		{
+			int cx,cy,cz;
+			hash.CellOf(&pnts[hash.Item(i)],&cx,&cy,&cz);
+			int j;
+			for(j = hash.BucketStart(b); j < i; j++)
+			{
+				int jx,jy,jz;
+				hash.CellOf(&pnts[hash.Item(j)],&jx,&jy,&jz);
+				if(jx == cx && jy == cy && jz == cz)
+					break;
+			}
+			leader[i] = j == i;
+			count += leader[i];
+		}
+		offset[b + 1] = count;
+	}
+	offset[0] = 0;
+	for(int b = 0; b < numbuckets; b++)
+		offset[b + 1] += offset[b];
+	int numout = offset[numbuckets];
+
+	ScanPoint *out = new ScanPoint[numout > 0 ? numout : 1];
+#pragma omp parallel for schedule(dynamic,4096)
+	for(int b = 0; b < numbuckets; b++)
+	{
+		int dst = offset[b];
+		for(int i = hash.BucketStart(b); i < hash.BucketEnd(b); i++)
+		{
+			if(!leader[i])
+				continue;
+			ScanPoint *first = &pnts[hash.Item(i)];
+			int cx,cy,cz;
+			hash.CellOf(first,&cx,&cy,&cz);
+			double x = 0,y = 0,z = 0,w = 0;
+			int r = 0,g = 0,bl = 0,num = 0;
+			for(int j = i; j < hash.BucketEnd(b); j++)
+			{
+				ScanPoint *p = &pnts[hash.Item(j)];
+				int jx,jy,jz;
+				hash.CellOf(p,&jx,&jy,&jz);
+				if(jx != cx || jy != cy || jz != cz)
+					continue;
+				double pw = p->weight > 0 ? p->weight : 1e-6;
+				x += p->x * pw;
+				y += p->y * pw;
+				z += p->z * pw;
+				w += pw;
+				r += p->R();
+				g += p->G();
+				bl += p->B();
+				num++;
+			}
+			ScanPoint *sp = &out[dst++];
+			sp->x = (float)(x / w);
+			sp->y = (float)(y / w);
+			sp->z = (float)(z / w);
+			sp->SetColor(r / num,g / num,bl / num);
+			sp->pixel = first->pixel;
+			sp->weight = (float)w;
+		}
+	}
+	memcpy(pnts,out,sizeof(ScanPoint) * numout);
+	delete []out;
+	delete []leader;
+	delete []offset;
+	return numout;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "ScanPoint.h"
+/*
+Cleans up and thins a scanned cloud before it's exported or meshed.
+The stages run in this order, each one is skipped when it's switched off:
+	ClipDepth - drops points nearer or farther from the viewpoint than the depth range,
+		this gets rid of the background and stray hits near the camera
+	RemoveRadiusOutliers - drops points with fewer than m_minneighbors others within m_radius
+	RemoveStatisticalOutliers - drops points whose mean distance to their m_statk
+		nearest neighbours is more than m_statstddev standard deviations above the
+		cloud's average, this is what removes the stray laser reflections
+	VoxelDownsample - replaces the points in each m_voxelsize cube by their weighted average
+
+Everything works in place on a contiguous ScanPoint array and returns the new count,
+the removal stages keep the order of the surviving points. The neighbour searches go through a
+SpatialHash and run in parallel (OpenMP), the results don't depend on the thread count.
+*/
+class PointFilter
+{
+public:
+	float m_mindepth; // depth range in world units (mm), m_maxdepth = 0 turns clipping off
+	float m_maxdepth;
+	float m_radius; // 0 = no radius outlier removal
+	int m_minneighbors;
+	int m_statk; // 0 = no statistical outlier removal
+	float m_statstddev;
+	float m_voxelsize; // 0 = no downsampling
+
+	PointFilter();
+	void SetViewpoint(float x,float y,float z);
+	int Run(ScanPoint *pnts,int numpnts);
+
+	int ClipDepth(ScanPoint *pnts,int numpnts);
+	int RemoveRadiusOutliers(ScanPoint *pnts,int numpnts);
+	int RemoveStatisticalOutliers(ScanPoint *pnts,int numpnts);
+	int VoxelDownsample(ScanPoint *pnts,int numpnts);
+private:
+	float m_viewx,m_viewy,m_viewz;
+	int Compact(ScanPoint *pnts,int numpnts,unsigned char *keep);
+};
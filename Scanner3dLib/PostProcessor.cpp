@@ -1,5 +1,10 @@
 #include "PostProcessor.h"
 #include "scanner3dlib.h"
+#include "GridMesher.h"
+#include "DelaunayFast.h"
+#include "PointFilter.h"
+#include "NormalEstimator.h"
+#include "StreamMerger.h"
 
 extern ScannerAlg *pScanner;
 PostProcessor::PostProcessor(void)
@@ -17,90 +22,112 @@ Every 3d point generated by the ScannerAlg corresponds
 directly to 1 2d point from the scanned image. 
 This algorithm creates an X*Y map, where X and Y is the image size.
 Each 3d point is sorted into it's correct spot.
-Then, each point is merged (averaged) to reduce jitter associated
+Then, each point is merged (a weighted average, see LiveMerge) to reduce jitter associated
 with multiple scans. This will vastly reduce the number of points down 
 to ImageXSize*ImageYSize or less, before running this alg, the potential 
 max number of points is ImageXSize * ImageYSize * #Scanned Frames.
 */
-void PostProcessor::Merge(List *outlst)
+void PostProcessor::Merge(Array<point_3d *> *outlst)
 {
-	int width;
-	int height;
-	if(ImProc::Instance()->GetReference() == 0)
-		return;
-	width = ImProc::Instance()->GetReference()->width;
-	height = ImProc::Instance()->GetReference()->height;
-	//create some storage for this
-	List *map = new List[width * height];
-	for(int c=0;c<(width*height);c++)
-		map[c].Init();
-	List composited;
-	Composite(&composited);
-	//iterate through all the points in all scanned frames
-	for (ListItem *li = composited.list ; li != 0 ; li=li->next)
+	ScanPoint *merged;
+	int nummerged = MergePoints(&merged);
+	for(int c = 0; c < nummerged; c++)
 	{
-		//Now add it to the correct bucket.
-		point_3d *pnt = (point_3d *)li->data;
-		map[pnt->m_p2d.Y * width + pnt->m_p2d.X].Add(pnt);
+		//create a new point
+		point_3d *newpnt = new point_3d();
+		merged[c].ToPoint3d(newpnt);
+		//save it to the output list
+		outlst->Add(newpnt);
 	}
-	//now all the points are correctly sorted in thier buckets
+	delete []merged;
+}
+
+/*
+The merge on compact points, each pixel's points are fused into one point,
+a weighted average by each point's confidence, with the color of the most
+trusted point. The fusing is done by the scanner's LiveMerge as the frames
+are collected, so this is just a copy
+*/
+int PostProcessor::MergePoints(ScanPoint **out, float **variance)
+{
+	*out = 0;
+	if(variance != 0)
+		*variance = 0;
+	if(ImProc::Instance()->GetReference() == 0)
+		return 0;
+	pScanner->CollectFrames(); // bring the live merge up to date
+	LiveMerge *live = pScanner->GetLiveMerge();
+	int size = live->NumPixels() > 0 ? live->NumPixels() : 1;
+	ScanPoint *merged = new ScanPoint[size];
+	*out = merged;
+	if(variance == 0)
+		return live->Snapshot(merged);
+	*variance = new float[size];
+	return live->Snapshot(merged,*variance);
+}
 
-	//walk through each and every position and create a new point that is the average in that X/Y spot
-	float tx,ty,tz;
-	int numpoints;
-	for(int y = 0; y < height; y++)
+/*
+The frames still in memory are spooled as well, so the whole scan is
+merged from disk
+*/
+int PostProcessor::MergeSpool(char * plyfile, int budgetmb)
+{
+	if(pScanner->SpoolFrames() < 0)
+		return -1;
+	ScanSpool spool;
+	if(!pScanner->OpenSpool(&spool))
+		return -1;
+	StreamMerger merger;
+	merger.m_budget = (size_t)budgetmb * 1024 * 1024;
+	return merger.Merge(&spool,plyfile);
+}
+
+/*
+Gather all of the points of the scanned frames into one array of compact points,
+the frames that have been spooled are read back from the spool first
+*/
+int PostProcessor::CompositePoints(ScanPoint **out)
+{
+	pScanner->CollectFrames(); // bring in any frames the workers have finished
+	ScanSpool spool;
+	int numspooled = 0;
+	if(pScanner->IsSpooled() && pScanner->OpenSpool(&spool))
+		numspooled = spool.NumPoints();
+	int numpnts = numspooled;
+	for(int f = 0; f < pScanner->m_pFrames->Count(); f++)
+		numpnts += pScanner->m_pFrames->GetItem(f)->m_pPoints->Count();
+	ScanPoint *pnts = new ScanPoint[numpnts > 0 ? numpnts : 1];
+	int c = 0;
+	if(numspooled > 0)
+		c = spool.Read(pnts,numspooled);
+	spool.Close();
+	for(int f = 0; f < pScanner->m_pFrames->Count(); f++)
 	{
-		for(int x = 0; x < width; x++)
-		{
-			tx = 0.0f;
-			ty = 0.0f;
-			tz = 0.0f;
-			numpoints = map[y * width + x].Count();
-			if(numpoints > 0) // if not an empty list
-			{
-				//iterate through all the points at this position
-				Color clr;
-				for(ListItem *li = map[y * width + x].list; li != 0; li = li->next)
-				{
-					point_3d *tmp = (point_3d *)li->data;
-					tx += tmp->Wx;
-					ty += tmp->Wy;
-					tz += tmp->Wz;
-					clr = tmp->m_color;
-				}
-				//create a new point
-				point_3d *newpnt = new point_3d();
-				//average the values
-				newpnt->Wx = tx / (float)numpoints;
-				newpnt->Wy = ty / (float)numpoints;
-				newpnt->Wz = tz / (float)numpoints;
-				newpnt->m_color = clr;
-				//save it to the output list
-				outlst->Add(newpnt);
-			}
-		}
+		ScannerFrame *sf = pScanner->m_pFrames->GetItem(f);
+		for(int p = 0; p < sf->m_pPoints->Count(); p++)
+			pnts[c++].FromPoint3d(sf->m_pPoints->GetItem(p));
 	}
-	delete []map;
-
+	*out = pnts;
+	return c;
 }
+
 /*
 Composite does not create any new points,
 it just gathers them up from the scannerframes
 */
-void PostProcessor::Composite(List *outlst)
+bool PostProcessor::Composite(Array<point_3d *> *outlst)
 {	
-	for (ListItem *li = pScanner->m_pFrames->list ; li != 0 ; li=li->next)
+	pScanner->CollectFrames(); // bring in any frames the workers have finished
+	for(int f = 0; f < pScanner->m_pFrames->Count(); f++)
 	{
-		ScannerFrame *sf = (ScannerFrame *)li->data;
-		for(ListItem *li2 = sf->m_pPoints->list ; li2 !=0 ; li2 = li2->next)
-		{			
-			point_3d *pnt = (point_3d *)li2->data;
-			outlst->Add(pnt);	
-		}
+		ScannerFrame *sf = pScanner->m_pFrames->GetItem(f);
+		for(int p = 0; p < sf->m_pPoints->Count(); p++)
+			outlst->Add(sf->m_pPoints->GetItem(p));
 	}	
+	return !pScanner->IsSpooled();
 }
 
-void PostProcessor::SaveData(char * filename, List *lstpnts)
+void PostProcessor::SaveData(char * filename, Array<point_3d *> *lstpnts)
 {
 	FILE *fp = fopen(filename,"wb");
 
@@ -117,11 +144,224 @@ void PostProcessor::SaveData(char * filename, List *lstpnts)
 	fprintf(fp,"property list uchar int vertex_indices\r\n");
 	fprintf(fp,"end_header\r\n");
 
-	for(ListItem *li = lstpnts->list; li!=0; li=li->next)
+	for(int c = 0; c < lstpnts->Count(); c++)
 	{
-		point_3d *pnt = (point_3d *)li->data;
+		point_3d *pnt = lstpnts->GetItem(c);
 		fprintf(fp,"%f %f %f %d %d %d\r\n",pnt->Wx,pnt->Wy,pnt->Wz,pnt->m_color.R,pnt->m_color.G,pnt->m_color.B);
 	}
 
 	fclose(fp);
-}
\ No newline at end of file
+}
+void PostProcessor::SaveData(char * filename, ScanPoint *pnts, int numpnts, float *normals)
+{
+	FILE *fp = fopen(filename,"wb");
+	if(fp == 0)
+		return;
+
+	fprintf(fp,"ply\r\n");
+	fprintf(fp,"format ascii 1.0\r\n");
+	fprintf(fp,"element vertex %d\r\n",numpnts);
+	fprintf(fp,"property float x\r\n");
+	fprintf(fp,"property float y\r\n");
+	fprintf(fp,"property float z\r\n");
+	if(normals)
+	{
+		fprintf(fp,"property float nx\r\n");
+		fprintf(fp,"property float ny\r\n");
+		fprintf(fp,"property float nz\r\n");
+	}
+	fprintf(fp,"property uchar diffuse_red\r\n");
+	fprintf(fp,"property uchar diffuse_green\r\n");
+	fprintf(fp,"property uchar diffuse_blue\r\n");
+	fprintf(fp,"element face 0\r\n");
+	fprintf(fp,"property list uchar int vertex_indices\r\n");
+	fprintf(fp,"end_header\r\n");
+
+	for(int c = 0; c < numpnts; c++)
+	{
+		ScanPoint *pnt = &pnts[c];
+		if(normals)
+		{
+			float *n = &normals[c * 3];
+			fprintf(fp,"%f %f %f %f %f %f %d %d %d\r\n",pnt->x,pnt->y,pnt->z,n[0],n[1],n[2],pnt->R(),pnt->G(),pnt->B());
+		}
+		else
+			fprintf(fp,"%f %f %f %d %d %d\r\n",pnt->x,pnt->y,pnt->z,pnt->R(),pnt->G(),pnt->B());
+	}
+
+	fclose(fp);
+}
+
+int PostProcessor::Filter(ScanPoint *pnts, int numpnts)
+{
+	ScannerConfig *cfg = pScanner->pConfig;
+	PointFilter filter;
+	filter.m_mindepth = cfg->m_filtermindepth;
+	filter.m_maxdepth = cfg->m_filtermaxdepth;
+	filter.m_radius = cfg->m_filterradius;
+	filter.m_minneighbors = cfg->m_filterminneighbors;
+	filter.m_statk = cfg->m_filterstatk;
+	filter.m_statstddev = cfg->m_filterstddev;
+	filter.m_voxelsize = cfg->m_filtervoxel;
+	float x,y,z;
+	cfg->m_camera.GetPosition(&x,&y,&z);
+	filter.SetViewpoint(x,y,z);
+	return filter.Run(pnts,numpnts);
+}
+
+void PostProcessor::EstimateNormals(ScanPoint *pnts, int numpnts, bool organized, float *normals)
+{
+	NormalEstimator est;
+	float x,y,z;
+	pScanner->pConfig->m_camera.GetPosition(&x,&y,&z);
+	est.SetViewpoint(x,y,z);
+	IplImage *ref = ImProc::Instance()->GetReference();
+	if(organized && ref != 0)
+		est.GridNormals(pnts,numpnts,ref->width,ref->height,normals);
+	else
+		est.PCANormals(pnts,numpnts,normals);
+}
+
+/*
+Binary (little endian) PLY, so large meshes save quickly,
+the vertices and faces are packed into a buffer and written in chunks
+*/
+void PostProcessor::SaveMesh(char * filename, ScanPoint *pnts, int numpnts, int *tris, int numtris, float *normals)
+{
+	FILE *fp = fopen(filename,"wb");
+	if(fp == 0)
+		return;
+	//binary PLY readers want plain \n line endings in the header
+	fprintf(fp,"ply\n");
+	fprintf(fp,"format binary_little_endian 1.0\n");
+	fprintf(fp,"element vertex %d\n",numpnts);
+	fprintf(fp,"property float x\n");
+	fprintf(fp,"property float y\n");
+	fprintf(fp,"property float z\n");
+	if(normals)
+	{
+		fprintf(fp,"property float nx\n");
+		fprintf(fp,"property float ny\n");
+		fprintf(fp,"property float nz\n");
+	}
+	fprintf(fp,"property uchar diffuse_red\n");
+	fprintf(fp,"property uchar diffuse_green\n");
+	fprintf(fp,"property uchar diffuse_blue\n");
+	fprintf(fp,"element face %d\n",numtris);
+	fprintf(fp,"property list uchar int vertex_indices\n");
+	fprintf(fp,"end_header\n");
+
+	const int chunk = 4096;
+	unsigned char *buf = new unsigned char[chunk * 27];
+	for(int c = 0; c < numpnts; c += chunk)
+	{
+		unsigned char *dst = buf;
+		int end = (c + chunk < numpnts) ? c + chunk : numpnts;
+		for(int i = c; i < end; i++)
+		{
+			memcpy(dst,&pnts[i].x,sizeof(float) * 3);
+			dst += 12;
+			if(normals)
+			{
+				memcpy(dst,&normals[i * 3],sizeof(float) * 3);
+				dst += 12;
+			}
+			dst[0] = pnts[i].R();
+			dst[1] = pnts[i].G();
+			dst[2] = pnts[i].B();
+			dst += 3;
+		}
+		fwrite(buf,dst - buf,1,fp);
+	}
+	for(int c = 0; c < numtris; c += chunk)
+	{
+		unsigned char *dst = buf;
+		int end = (c + chunk < numtris) ? c + chunk : numtris;
+		for(int i = c; i < end; i++)
+		{
+			dst[0] = 3;
+			memcpy(dst + 1,&tris[i * 3],sizeof(int) * 3);
+			dst += 13;
+		}
+		fwrite(buf,dst - buf,1,fp);
+	}
+	delete []buf;
+	fclose(fp);
+}
+
+bool PostProcessor::SaveMergedMesh(char * filename, float maxedge)
+{
+	if(ImProc::Instance()->GetReference() == 0)
+		return false;
+	ScanPoint *pnts;
+	int numpnts = MergePoints(&pnts);
+	GridMesher mesher;
+	mesher.m_maxedge = maxedge;
+	int *tris;
+	int numtris = mesher.Triangulate(pnts,numpnts,ImProc::Instance()->GetReference()->width,
+		ImProc::Instance()->GetReference()->height,&tris);
+	float *normals = new float[(numpnts > 0 ? numpnts : 1) * 3];
+	EstimateNormals(pnts,numpnts,true,normals);
+	SaveMesh(filename,pnts,numpnts,tris,numtris,normals);
+	delete []normals;
+	delete []tris;
+	delete []pnts;
+	return true;
+}
+
+/*
+The raw points go through Filter first, with an outlier stage set up it
+keeps stray points from pulling long triangles across the mesh.
+The triangulation is done in the image, on each point's pixel, which is
+the view the surface was scanned from, so it doesn't fold over itself.
+Points that share a pixel are skipped by DelaunayFast after the first and
+stay as loose vertices. Triangles can still join surfaces at different
+depths, any with an edge longer than maxedge in 3d are dropped like
+GridMesher does, and they're wound the same way as GridMesher's
+*/
+bool PostProcessor::SaveCloudMesh(char * filename, float maxedge)
+{
+	ScanPoint *pnts;
+	int numpnts = CompositePoints(&pnts);
+	numpnts = Filter(pnts,numpnts);
+	ScanPoint *image = new ScanPoint[numpnts > 0 ? numpnts : 1];
+	for(int c = 0; c < numpnts; c++)
+	{
+		image[c] = pnts[c];
+		image[c].x = (float)pnts[c].PixelX();
+		image[c].y = (float)pnts[c].PixelY();
+		image[c].z = 0;
+	}
+	DelaunayFast dt;
+	int *tris;
+	int numtris = dt.Triangulate(image,numpnts,&tris);
+	delete []image;
+	float max2 = maxedge * maxedge;
+	int kept = 0;
+	for(int t = 0; t < numtris; t++)
+	{
+		int *tri = &tris[t * 3];
+		bool ok = true;
+		for(int e = 0; e < 3 && ok; e++)
+		{
+			ScanPoint *a = &pnts[tri[e]],*b = &pnts[tri[(e + 1) % 3]];
+			float dx = a->x - b->x,dy = a->y - b->y,dz = a->z - b->z;
+			ok = (dx * dx + dy * dy + dz * dz) <= max2;
+		}
+		if(!ok)
+			continue;
+		int *dst = &tris[kept * 3];
+		int v0 = tri[0],v1 = tri[1],v2 = tri[2];
+		dst[0] = v0;
+		dst[1] = v2;
+		dst[2] = v1;
+		kept++;
+	}
+	float *normals = new float[(numpnts > 0 ? numpnts : 1) * 3];
+	EstimateNormals(pnts,numpnts,false,normals);
+	SaveMesh(filename,pnts,numpnts,tris,kept,normals);
+	delete []normals;
+	delete []tris;
+	delete []pnts;
+	return true;
+}
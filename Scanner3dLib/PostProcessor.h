@@ -1,7 +1,8 @@
 #ifndef POST_PROCESSOR
 #define POST_PROCESSOR
 
-#include "ListItem.h"
+#include "Array.h"
+#include "ScanPoint.h"
 class PostProcessor
 {
 public:
@@ -9,13 +10,49 @@ public:
 	Merge allocates a new list as well as allocating new points 
 	in the list
 	*/
-	void Merge(List *outlist);
+	void Merge(Array<point_3d *> *outlist);
 	/* 
 	the composite function gets all the points from the 
-	scanner frames, the only new thing allocated is the List itself, no new points
+	scanner frames, the only new thing allocated is the Array itself, no new points.
+	returns false if some of the frames have been spooled, those are only in CompositePoints
 	*/
-	void Composite(List *outlist);
-	void SaveData(char * filename, List *lstpnts);
+	bool Composite(Array<point_3d *> *outlist);
+	void SaveData(char * filename, Array<point_3d *> *lstpnts);
+	/*
+	The same on compact points, spooled frames included, the arrays are
+	allocated with new[] and belong to the caller
+	*/
+	int CompositePoints(ScanPoint **out);
+	// variance is optional, the spread of each merged point's samples in mm^2 (see LiveMerge)
+	int MergePoints(ScanPoint **out, float **variance = 0);
+	// normals is optional, 3 floats per point (see NormalEstimator)
+	void SaveData(char * filename, ScanPoint *pnts, int numpnts, float *normals = 0);
+	/*
+	runs the PointFilter stages set up in the scanner config on the points,
+	in place, returns how many are left
+	*/
+	int Filter(ScanPoint *pnts, int numpnts);
+	/*
+	normals gets 3 floats per point, facing the camera. organized is for
+	points with at most one per pixel (MergePoints), anything else uses the
+	slower nearest neighbour estimate
+	*/
+	void EstimateNormals(ScanPoint *pnts, int numpnts, bool organized, float *normals);
+	// binary PLY with faces, tris holds 3 point indices per triangle
+	void SaveMesh(char * filename, ScanPoint *pnts, int numpnts, int *tris, int numtris, float *normals = 0);
+	/*
+	MergePoints for sessions bigger than memory, the scan is merged from
+	its spool (ScannerAlg::SpoolFrames) in budgetmb of memory and the merged
+	points go straight to a binary PLY. returns the number of points, -1 on error
+	*/
+	int MergeSpool(char * plyfile, int budgetmb);
+	// merge the scan, mesh it on the image grid (see GridMesher) and save it
+	bool SaveMergedMesh(char * filename, float maxedge);
+	/*
+	the same for every point of every frame, clouds with more than one point
+	per pixel can't use the image grid so they're meshed with DelaunayFast
+	*/
+	bool SaveCloudMesh(char * filename, float maxedge);
 	PostProcessor(void);
 	~PostProcessor(void);
 
@@ -1,6 +1,12 @@
 
 #include "rtutil.hpp"
 #include "vector3d.hpp"
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#define RTUTIL_SSE
+#include <xmmintrin.h>
+#endif
+
+#define RTUTIL_PARALLEL_EPS 1e-8f // rays with |n.d| below this are considered parallel to the plane
 
 class TestPoint{public:	double X,Y;};
 static TestPoint TstPnt[4]; //for the crossing test
@@ -75,6 +81,72 @@ bool IntersectPlane(Plane *pln, point_3d *start,Vector3d *dir,point_3d *intersec
 	return true;
 }
 
+/*
+Batched version of IntersectPlane for a bundle of rays that share one origin
+(such as all of the laser pixels of a frame, which are cast from the camera).
+The directions are passed as separate x/y/z arrays (structure of arrays) so that
+4 rays are intersected per SSE instruction, the remainder (and non-x86 builds)
+use the scalar loop. The math is done in float, not double like IntersectPlane.
+mask[i] is set to 1 for a valid intersection, or 0 if the ray is parallel to
+the plane or the plane is behind the origin. The outputs are undefined where 
+the mask is 0. Returns the number of valid intersections.
+Unlike IntersectPlane, hits behind the origin (t <= 0) and nearly parallel
+rays are rejected. The scanners cast these rays from the camera, so such a hit
+can't be a point the camera saw; it only happens when the laser plane is wrong
+and lands behind the camera or far off at a grazing angle.
+*/
+int IntersectPlaneBatch(Plane *pln, point_3d *origin,const float *dx,const float *dy,const float *dz,int n,
+						float *outx,float *outy,float *outz,unsigned char *mask){
+	//the numerator of t is the same for every ray
+	float S = -(pln->a*origin->Wx + pln->b*origin->Wy + pln->c*origin->Wz + pln->d);
+	int count = 0;
+	int i = 0;
+#ifdef RTUTIL_SSE
+	__m128 A = _mm_set1_ps(pln->a);
+	__m128 B = _mm_set1_ps(pln->b);
+	__m128 C = _mm_set1_ps(pln->c);
+	__m128 num = _mm_set1_ps(S);
+	__m128 ox = _mm_set1_ps(origin->Wx);
+	__m128 oy = _mm_set1_ps(origin->Wy);
+	__m128 oz = _mm_set1_ps(origin->Wz);
+	__m128 eps = _mm_set1_ps(RTUTIL_PARALLEL_EPS);
+	__m128 signbit = _mm_set1_ps(-0.0f);
+	__m128 zero = _mm_setzero_ps();
+	for(; i + 4 <= n; i += 4){
+		__m128 x = _mm_loadu_ps(dx + i);
+		__m128 y = _mm_loadu_ps(dy + i);
+		__m128 z = _mm_loadu_ps(dz + i);
+		__m128 denom = _mm_add_ps(_mm_add_ps(_mm_mul_ps(A,x),_mm_mul_ps(B,y)),_mm_mul_ps(C,z));
+		__m128 t = _mm_div_ps(num,denom);
+		//valid if not parallel and in front of the origin (NaN compares false)
+		__m128 ok = _mm_and_ps(_mm_cmpgt_ps(_mm_andnot_ps(signbit,denom),eps),_mm_cmpgt_ps(t,zero));
+		_mm_storeu_ps(outx + i,_mm_add_ps(ox,_mm_mul_ps(t,x)));
+		_mm_storeu_ps(outy + i,_mm_add_ps(oy,_mm_mul_ps(t,y)));
+		_mm_storeu_ps(outz + i,_mm_add_ps(oz,_mm_mul_ps(t,z)));
+		int bits = _mm_movemask_ps(ok);
+		for(int k = 0; k < 4; k++){
+			mask[i + k] = (unsigned char)((bits >> k) & 1);
+			count += mask[i + k];
+		}
+	}
+#endif
+	for(; i < n; i++){
+		float denom = pln->a*dx[i] + pln->b*dy[i] + pln->c*dz[i];
+		mask[i] = 0;
+		if(fabs(denom) <= RTUTIL_PARALLEL_EPS)
+			continue; //ray is parallel, no intersection
+		float t = S / denom;
+		if(t <= 0.0f)
+			continue; //plane is behind the origin
+		outx[i] = origin->Wx + (t * dx[i]);
+		outy[i] = origin->Wy + (t * dy[i]);
+		outz[i] = origin->Wz + (t * dz[i]);
+		mask[i] = 1;
+		count++;
+	}
+	return count;
+}
+
 short IntersectSphere(point_3d *start,point_3d *end,point_3d *intersect,
 				 point_3d *center,float radius){
 	short retval =0;
@@ -11,6 +11,9 @@
 #define RTUTIL
 
 bool IntersectPlane(Plane *pln, point_3d *start,Vector3d *dir,point_3d *intersection);
+// batched ray/plane intersection for rays sharing one origin, directions as x/y/z arrays
+int IntersectPlaneBatch(Plane *pln, point_3d *origin,const float *dx,const float *dy,const float *dz,int n,
+						float *outx,float *outy,float *outz,unsigned char *mask);
 short IntersectSphere(point_3d *start,point_3d *end,point_3d *intersect, point_3d *center,float radius);
 bool insphere(point_3d *spherecenter,float sprad,point_3d *tstcenter);
 
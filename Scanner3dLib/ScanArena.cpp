@@ -0,0 +1,119 @@
+#include "ScanArena.h"
+#include <stdlib.h>
+#include <new>
+#include <windows.h>
+
+// everything handed out is aligned to this
+#define ARENA_ALIGN 16
+
+ScanArena::ScanArena(size_t blocksize)
+{
+	m_blocksize = blocksize;
+	m_first = 0;
+	m_current = 0;
+	m_pos = 0;
+	m_end = 0;
+	m_used = 0;
+	m_liveframes = 0;
+}
+
+ScanArena::~ScanArena()
+{
+	Release();
+}
+
+static char *BlockData(void *block,size_t headersize)
+{
+	return (char *)block + headersize;
+}
+
+/*
+Move on to the next block that can hold size bytes,
+reusing the blocks from before a Reset if there are any
+*/
+bool ScanArena::NextBlock(size_t size)
+{
+	size_t header = (sizeof(Block) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	Block *prev = m_current;
+	Block *blk = m_current ? m_current->next : m_first;
+	//skip over any old blocks too small for this (only happens for huge allocations)
+	while(blk != 0 && blk->size < size)
+	{
+		prev = blk;
+		blk = blk->next;
+	}
+	if(blk == 0)
+	{
+		size_t datasize = size > m_blocksize ? size : m_blocksize;
+		blk = (Block *)malloc(header + datasize + ARENA_ALIGN);
+		if(blk == 0)
+			return false;
+		blk->size = datasize;
+		blk->next = 0;
+		if(prev)
+		{
+			//link it in after prev, keeping whatever followed
+			blk->next = prev->next;
+			prev->next = blk;
+		}
+		else
+		{
+			blk->next = m_first;
+			m_first = blk;
+		}
+	}
+	m_current = blk;
+	//malloc only guarantees 8 bytes on 32 bit windows
+	size_t start = ((size_t)BlockData(blk,header) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	m_pos = (char *)start;
+	m_end = m_pos + blk->size;
+	return true;
+}
+
+void *ScanArena::Alloc(size_t size)
+{
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if(m_pos == 0 || (size_t)(m_end - m_pos) < size)
+	{
+		if(!NextBlock(size))
+			throw std::bad_alloc();
+	}
+	void *ret = m_pos;
+	m_pos += size;
+	m_used += size;
+	return ret;
+}
+
+/*
+Forget everything that was allocated, the blocks are kept
+and handed out again from the start
+*/
+void ScanArena::Reset()
+{
+	m_current = 0;
+	m_pos = 0;
+	m_end = 0;
+	m_used = 0;
+}
+
+void ScanArena::FrameMade()
+{
+	InterlockedIncrement((volatile LONG *)&m_liveframes);
+}
+
+void ScanArena::FrameFreed()
+{
+	InterlockedDecrement((volatile LONG *)&m_liveframes);
+}
+
+void ScanArena::Release()
+{
+	Block *next;
+	for(Block *blk = m_first; blk != 0; blk = next)
+	{
+		next = blk->next;
+		free(blk);
+	}
+	m_first = 0;
+	Reset();
+}
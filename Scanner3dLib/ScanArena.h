@@ -0,0 +1,54 @@
+#pragma once
+#include <stddef.h>
+/*
+A monotonic (bump pointer) allocator for everything that lives as long
+as a scan does: the points, the ScannerFrames and their list nodes.
+Allocating is a pointer increment, nothing is freed on its own,
+Reset throws everything away at once and keeps the blocks for the next scan.
+Objects placed in the arena never have their destructors called, so only
+put things in here that don't own heap memory.
+Not thread safe, each ScannerAlg has its own.
+The exception is the count of live ScannerFrames, which the reader of a shared
+FrameAccumulator decrements when it frees another scanner's frames. Reset
+mustn't be called while it's non zero, those frames are still in use.
+
+	point_3d *p = new(arena) point_3d(x,y,z);
+*/
+class ScanArena
+{
+public:
+	ScanArena(size_t blocksize = 1024 * 1024);
+	~ScanArena();
+	void *Alloc(size_t size);
+	void Reset(); // O(1) in the number of objects, keeps the memory
+	void Release(); // gives the memory back too
+	size_t BytesUsed(){return m_used;}
+	// called by ScannerFrame, safe from any thread
+	void FrameMade();
+	void FrameFreed();
+	long LiveFrames(){return m_liveframes;}
+private:
+	struct Block
+	{
+		Block *next;
+		size_t size;
+		// the data follows
+	};
+	size_t m_blocksize;
+	Block *m_first; // all of the blocks, in the order they were made
+	Block *m_current; // the block being allocated from
+	char *m_pos; // next free byte in m_current
+	char *m_end;
+	size_t m_used;
+	volatile long m_liveframes;
+	bool NextBlock(size_t size);
+};
+
+inline void *operator new(size_t size,ScanArena &arena)
+{
+	return arena.Alloc(size);
+}
+// only called if a constructor throws
+inline void operator delete(void *,ScanArena &)
+{
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "point3d.hpp"
+/*
+The compact point that's kept for accumulating and exporting scans.
+point_3d carries the camera coordinates and a 3 long Point2D that are only
+needed while unprojecting, this keeps just what's needed afterwards:
+world position, color, the pixel the point came from and how much it's
+trusted when it's merged with the other points from that pixel. 24 bytes vs 44,
+and it's meant to be stored by value in arrays, not through a list of pointers.
+*/
+class ScanPoint
+{
+public:
+	float x,y,z; // world coords
+	unsigned int rgb; // 0x00RRGGBB
+	unsigned int pixel; // (Y << 16) | X of the image pixel this came from
+	float weight; // confidence, see ScannerAlg::WeighBatch, the sum of the weights once merged
+
+	static unsigned int PackPixel(int px,int py){return ((unsigned int)py << 16) | ((unsigned int)px & 0xffff);}
+	int PixelX(){return (int)(pixel & 0xffff);}
+	int PixelY(){return (int)(pixel >> 16);}
+	unsigned char R(){return (unsigned char)(rgb >> 16);}
+	unsigned char G(){return (unsigned char)(rgb >> 8);}
+	unsigned char B(){return (unsigned char)rgb;}
+	void SetColor(unsigned char r,unsigned char g,unsigned char b)
+	{
+		rgb = ((unsigned int)r << 16) | ((unsigned int)g << 8) | b;
+	}
+	// conversions for the code that still works with point_3d
+	void FromPoint3d(point_3d *p)
+	{
+		x = p->Wx;
+		y = p->Wy;
+		z = p->Wz;
+		SetColor(p->m_color.R,p->m_color.G,p->m_color.B);
+		pixel = PackPixel(p->m_p2d.X,p->m_p2d.Y);
+		weight = p->m_weight;
+	}
+	void ToPoint3d(point_3d *p)
+	{
+		p->Wx = x;
+		p->Wy = y;
+		p->Wz = z;
+		p->m_color.R = R();
+		p->m_color.G = G();
+		p->m_color.B = B();
+		p->m_p2d.X = PixelX();
+		p->m_p2d.Y = PixelY();
+		p->m_weight = weight;
+	}
+};
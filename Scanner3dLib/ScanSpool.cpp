@@ -0,0 +1,188 @@
+#include "ScanSpool.h"
+#include <string.h>
+#include <windows.h>
+#include <windows.h>
+
+#define SPOOL_VERSION 2 // 2 = ScanPoint has a weight
+
+ScanSpool::ScanSpool()
+{
+	m_fp = 0;
+	m_filename[0] = 0;
+	m_writing = false;
+	m_width = 0;
+	m_height = 0;
+	m_numframes = 0;
+	m_numpoints = 0;
+	m_frameleft = 0;
+}
+
+ScanSpool::~ScanSpool()
+{
+	Close();
+}
+
+bool ScanSpool::Create(char *filename,int width,int height)
+{
+	Close();
+	if(filename != m_filename)
+		strncpy(m_filename,filename,_MAX_PATH - 1);
+	m_filename[_MAX_PATH - 1] = 0;
+	m_fp = fopen(filename,"wb");
+	if(m_fp == 0)
+		return false;
+	m_writing = true;
+	m_width = width;
+	m_height = height;
+	m_numframes = 0;
+	m_numpoints = 0;
+	Header hdr;
+	memcpy(hdr.magic,"MSSP",4);
+	hdr.version = SPOOL_VERSION;
+	hdr.width = width;
+	hdr.height = height;
+	hdr.numframes = 0;
+	hdr.numpoints = 0;
+	return fwrite(&hdr,sizeof(hdr),1,m_fp) == 1;
+}
+
+bool ScanSpool::CreateTemp(int width,int height)
+{
+	Close();
+	char tmpdir[MAX_PATH];
+	if(GetTempPathA(MAX_PATH,tmpdir) == 0 || GetTempFileNameA(tmpdir,"mss",0,m_filename) == 0)
+	{
+		m_filename[0] = 0;
+		return false;
+	}
+	return Create(m_filename,width,height);
+}
+
+bool ScanSpool::Append()
+{
+	Close();
+	if(m_filename[0] == 0)
+		return false;
+	m_fp = fopen(m_filename,"r+b");
+	if(m_fp == 0)
+		return false;
+	Header hdr;
+	if(fread(&hdr,sizeof(hdr),1,m_fp) != 1 || memcmp(hdr.magic,"MSSP",4) != 0 || hdr.version != SPOOL_VERSION ||
+		fseek(m_fp,0,SEEK_END) != 0)
+	{
+		fclose(m_fp);
+		m_fp = 0;
+		return false;
+	}
+	m_writing = true;
+	m_width = hdr.width;
+	m_height = hdr.height;
+	m_numframes = hdr.numframes;
+	m_numpoints = hdr.numpoints;
+	return true;
+}
+
+bool ScanSpool::WriteFrame(ScanPoint *pnts,int numpnts)
+{
+	if(m_fp == 0 || !m_writing)
+		return false;
+	if(fwrite(&numpnts,sizeof(numpnts),1,m_fp) != 1)
+		return false;
+	if(numpnts > 0 && fwrite(pnts,sizeof(ScanPoint),numpnts,m_fp) != (size_t)numpnts)
+		return false;
+	m_numframes++;
+	m_numpoints += numpnts;
+	return true;
+}
+
+bool ScanSpool::Open(char *filename)
+{
+	Close();
+	if(filename != m_filename)
+		strncpy(m_filename,filename,_MAX_PATH - 1);
+	m_filename[_MAX_PATH - 1] = 0;
+	m_fp = fopen(filename,"rb");
+	if(m_fp == 0)
+		return false;
+	m_writing = false;
+	Header hdr;
+	if(fread(&hdr,sizeof(hdr),1,m_fp) != 1 || memcmp(hdr.magic,"MSSP",4) != 0 || hdr.version != SPOOL_VERSION)
+	{
+		Close();
+		return false;
+	}
+	m_width = hdr.width;
+	m_height = hdr.height;
+	m_numframes = hdr.numframes;
+	m_numpoints = hdr.numpoints;
+	m_frameleft = 0;
+	return true;
+}
+
+int ScanSpool::Read(ScanPoint *buf,int max)
+{
+	if(m_fp == 0 || m_writing)
+		return 0;
+	int num = 0;
+	while(num < max)
+	{
+		if(m_frameleft == 0)
+		{
+			//next frame, skipping empty ones
+			if(fread(&m_frameleft,sizeof(m_frameleft),1,m_fp) != 1)
+			{
+				m_frameleft = 0;
+				break;
+			}
+			continue;
+		}
+		int want = max - num < m_frameleft ? max - num : m_frameleft;
+		int got = (int)fread(&buf[num],sizeof(ScanPoint),want,m_fp);
+		num += got;
+		m_frameleft -= got;
+		if(got < want)
+		{
+			m_frameleft = 0; // truncated file, stop here
+			break;
+		}
+	}
+	return num;
+}
+
+bool ScanSpool::Rewind()
+{
+	if(m_fp == 0 || m_writing)
+		return false;
+	m_frameleft = 0;
+	return fseek(m_fp,sizeof(Header),SEEK_SET) == 0;
+}
+
+void ScanSpool::Close()
+{
+	if(m_fp == 0)
+		return;
+	if(m_writing)
+	{
+		//fill in the counts
+		fseek(m_fp,0,SEEK_SET);
+		Header hdr;
+		memcpy(hdr.magic,"MSSP",4);
+		hdr.version = SPOOL_VERSION;
+		hdr.width = m_width;
+		hdr.height = m_height;
+		hdr.numframes = m_numframes;
+		hdr.numpoints = m_numpoints;
+		fwrite(&hdr,sizeof(hdr),1,m_fp);
+	}
+	fclose(m_fp);
+	m_fp = 0;
+	m_writing = false;
+}
+
+void ScanSpool::Remove()
+{
+	Close();
+	if(m_filename[0] != 0)
+		remove(m_filename);
+	m_filename[0] = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include "ScanPoint.h"
+/*
+A scan session on disk, so a session can be larger than memory.
+ScannerAlg::SpoolFrames appends the frames collected so far and drops them
+from memory, the StreamMerger and PostProcessor::CompositePoints read the
+points back in chunks.
+
+file layout (little endian):
+	header: "MSSP", version, image width, image height, frame count, point count
+	each frame: point count, then that many ScanPoints
+The counts in the header are filled in by Close.
+*/
+class ScanSpool
+{
+public:
+	ScanSpool();
+	~ScanSpool();
+	// writing
+	bool Create(char *filename,int width,int height);
+	// Create on a new file in the temp folder
+	bool CreateTemp(int width,int height);
+	// reopens the file that was being written, more frames go on the end
+	bool Append();
+	bool WriteFrame(ScanPoint *pnts,int numpnts);
+	// reading, Read returns the next points (across frames), 0 at the end
+	bool Open(char *filename);
+	int Read(ScanPoint *buf,int max);
+	bool Rewind();
+	void Close();
+	// closes and deletes the file
+	void Remove();
+
+	int Width(){return m_width;}
+	int Height(){return m_height;}
+	int NumFrames(){return m_numframes;}
+	int NumPoints(){return m_numpoints;}
+	bool IsOpen(){return m_fp != 0;}
+	char *FileName(){return m_filename;}
+private:
+	struct Header
+	{
+		char magic[4];
+		int version;
+		int width;
+		int height;
+		int numframes;
+		int numpoints;
+	};
+	FILE *m_fp;
+	char m_filename[_MAX_PATH]; // empty = no file
+	bool m_writing;
+	int m_width;
+	int m_height;
+	int m_numframes;
+	int m_numpoints;
+	int m_frameleft; // points left to read in the current frame
+};
@@ -2,29 +2,262 @@
 #include "ScannerAlg.h"
 #include "rtutil.hpp"
 #include "improc.h"
+#include <math.h>
+
+#define PEAK_MAX_HALFWIDTH 16 // how far WeighBatch follows the laser line either side of a hit
+#define MIN_POINT_WEIGHT 0.001f
 // local function for unprojecting a 2d point back to 3d
 void UnProject(Point2D &p,point_3d *out, camera *cam, int Wid,int Hei);
 
 ScannerAlg::ScannerAlg()
 {
 	Build_Look_Up_Tables();
-	m_pFrames = new List();
+	m_pFrames = new Array<ScannerFrame *>();
+	m_pAccum = new FrameAccumulator();
+	m_ownaccum = true;
+	m_spooled = 0;
 	m_scanning = false;
+	m_batchsize = 0;
+	m_batchpos = 0;
+	m_batchdx = m_batchdy = m_batchdz = 0;
+	m_batchx = m_batchy = m_batchz = 0;
+	m_batchmask = 0;
+	m_batchcolor = 0;
+	m_batchweight = 0;
+	m_roilast = 0;
+	m_coarsehit = 0;
+	m_coarse = 0;
+	m_numlines = 0;
+	m_linelength = 0;
+	m_searchrows = true;
 }
 
 ScannerAlg::~ScannerAlg()
 {
 	ClearData();
 	delete m_pFrames;
+	if(m_ownaccum)
+		delete m_pAccum;
+	ReserveBatch(0);
+	delete []m_roilast;
+	delete []m_coarsehit;
+}
+
+/*
+Make sure the batch intersection buffers hold at least n entries
+(n = 0 frees them)
+*/
+void ScannerAlg::ReserveBatch(int n)
+{
+	if(n > 0 && n <= m_batchsize)
+		return;
+	delete []m_batchpos;
+	delete []m_batchdx;
+	delete []m_batchdy;
+	delete []m_batchdz;
+	delete []m_batchx;
+	delete []m_batchy;
+	delete []m_batchz;
+	delete []m_batchmask;
+	delete []m_batchcolor;
+	delete []m_batchweight;
+	m_batchpos = 0;
+	m_batchdx = m_batchdy = m_batchdz = 0;
+	m_batchx = m_batchy = m_batchz = 0;
+	m_batchmask = 0;
+	m_batchcolor = 0;
+	m_batchweight = 0;
+	m_batchsize = n;
+	if(n == 0)
+		return;
+	m_batchpos = new Point2D[n];
+	m_batchdx = new float[n];
+	m_batchdy = new float[n];
+	m_batchdz = new float[n];
+	m_batchx = new float[n];
+	m_batchy = new float[n];
+	m_batchz = new float[n];
+	m_batchmask = new unsigned char[n];
+	m_batchcolor = new Color[n];
+	m_batchweight = new float[n];
 }
 
 void ScannerAlg::StartScan()
 {
 	//clear any old data
 	ClearData();
+	m_tracker.Reset();
+	for(int i = 0; i < m_numlines; i++)
+		m_roilast[i] = -1;
 	m_scanning = true;
 }
 
+/*
+Get ready to search a new diff image, the lines are either the rows
+(the single alg) or the columns (the corner alg) of the image
+*/
+void ScannerAlg::BeginSearch(IplImage *diffFrame,bool rows)
+{
+	int numlines = rows ? diffFrame->height : diffFrame->width;
+	int linelength = rows ? diffFrame->width : diffFrame->height;
+	if(numlines != m_numlines || linelength != m_linelength || rows != m_searchrows)
+	{
+		delete []m_roilast;
+		delete []m_coarsehit;
+		m_roilast = new int[numlines];
+		m_coarsehit = new int[numlines];
+		for(int i = 0; i < numlines; i++)
+			m_roilast[i] = -1;
+		m_numlines = numlines;
+		m_linelength = linelength;
+		m_searchrows = rows;
+	}
+	switch(pConfig->m_searchstrategy)
+	{
+		case eSearchTracked:
+			m_tracker.BeginFrame(numlines,linelength);
+			break;
+		case eSearchPyramid:
+			m_coarse = ImProc::Instance()->GetTemporalPyramid(pConfig->m_pyramidlevels);
+			for(int i = 0; i < numlines; i++)
+				m_coarsehit[i] = -2;
+			break;
+		default:
+			break;
+	}
+}
+
+void ScannerAlg::EndSearch()
+{
+	if(pConfig->m_searchstrategy == eSearchTracked)
+		m_tracker.EndFrame();
+}
+
+/*
+Find the laser on the given line using the configured search strategy
+BeginSearch must have been called for this frame
+*/
+int ScannerAlg::TrackLaser(IplImage *diffFrame,int line)
+{
+	int start,end,pos;
+	switch(pConfig->m_searchstrategy)
+	{
+		case eSearchROI:
+			return ROILaser(diffFrame,line);
+		case eSearchPyramid:
+			return PyramidLaser(diffFrame,line);
+		case eSearchTracked:
+			break;
+		default:
+			return FindLaser(diffFrame,line);
+	}
+	//narrow the search down to a band around where the tracker predicts the laser
+	switch(m_tracker.GetSearchRange(line,&start,&end))
+	{
+		case eTrackSkip:
+			return -1;
+		case eTrackBand:
+			pos = FindLaser(diffFrame,line,start,end);
+			break;
+		default:
+			pos = FindLaser(diffFrame,line);
+			break;
+	}
+	m_tracker.Update(line,pos);
+	return pos;
+}
+
+/*
+Coarse to fine search, the brightest pixel on the matching line of the
+downsampled diff image says roughly where the laser is, then only a band
+of the full size line around it is searched. The coarse line is shared by
+2^levels full size lines, so it is only searched once per frame.
+The box filter spreads a thin line over the block, so the coarse threshold
+is lowered by the downsample factor, the full threshold still applies when refining
+*/
+int ScannerAlg::PyramidLaser(IplImage *diffFrame,int line)
+{
+	int levels = pConfig->m_pyramidlevels;
+	int factor = 1 << levels;
+	int cline = line >> levels;
+	int clines = m_coarse ? (m_searchrows ? m_coarse->height : m_coarse->width) : 0;
+	if(line < 0 || line >= m_numlines || cline >= clines)
+		return FindLaser(diffFrame,line); // no pyramid, or the odd lines past the downsampled edge
+	if(m_coarsehit[cline] == -2)
+	{
+		int clength = m_searchrows ? m_coarse->width : m_coarse->height;
+		int threshold = pConfig->m_brightnessthreshold / factor;
+		int brightest = threshold - 1;
+		unsigned char *data = (unsigned char *)m_coarse->imageData;
+		//step along the row or down the column
+		int step = m_searchrows ? 1 : m_coarse->widthStep;
+		unsigned char *pix = m_searchrows ? data + cline * m_coarse->widthStep : data + cline;
+		m_coarsehit[cline] = -1;
+		for(int i = 0; i < clength; i++, pix += step)
+		{
+			if(*pix > brightest)
+			{
+				brightest = *pix;
+				m_coarsehit[cline] = i;
+			}
+		}
+	}
+	int hit = m_coarsehit[cline];
+	if(hit == -1)
+		return -1;
+	//refine within the block plus one block either side
+	int start = (hit - 1) * factor;
+	int end = (hit + 2) * factor;
+	if(start < 0)
+		start = 0;
+	if(end > m_linelength)
+		end = m_linelength;
+	return FindLaser(diffFrame,line,start,end);
+}
+
+/*
+Look in a window around where the laser was on this line last frame.
+On a miss the window is grown (only the new pixels on either side are read)
+until it covers the whole line. Lines with no previous hit are searched in full.
+*/
+int ScannerAlg::ROILaser(IplImage *diffFrame,int line)
+{
+	if(line < 0 || line >= m_numlines)
+		return FindLaser(diffFrame,line);
+	int last = m_roilast[line];
+	int pos = -1;
+	if(last == -1)
+	{
+		pos = FindLaser(diffFrame,line);
+	}
+	else
+	{
+		int lo = last,hi = last; // the part of the line already searched [lo,hi)
+		int window = pConfig->m_roiwindow;
+		while(pos == -1 && (lo > 0 || hi < m_linelength))
+		{
+			int newlo = last - window;
+			int newhi = last + window + 1;
+			if(newlo < 0)
+				newlo = 0;
+			if(newhi > m_linelength)
+				newhi = m_linelength;
+			int left = (newlo < lo) ? FindLaser(diffFrame,line,newlo,lo) : -1;
+			int right = (hi < newhi) ? FindLaser(diffFrame,line,hi,newhi) : -1;
+			//if both sides have a hit, take the one closer to last time
+			if(left != -1 && (right == -1 || (last - left) <= (right - last)))
+				pos = left;
+			else
+				pos = right;
+			lo = newlo;
+			hi = newhi;
+			window *= 4;
+		}
+	}
+	m_roilast[line] = pos;
+	return pos;
+}
+
 
 
 /*
@@ -36,17 +269,10 @@ for the laserplane intersections.
 bool ScannerAlg::PlaneIntersect(Plane *plane,Point2D pos,point_3d *pnt_intersect)
 {
 	bool retval = false;
-	point_3d raypoint; // a point we use to create the ray
 	Vector3d direction; //the ray 
 	point_3d cam_pos; //position of the camera
 	pConfig->m_camera.GetPosition(&cam_pos); // I think this should work now...
-	// use the Camera world Z cordinate to unproject
-	raypoint.Cz = 1; // look into the sceen
-	IplImage *pRefImage = ImProc::Instance()->GetCurFrame();
-	UnProject(pos,&raypoint,&pConfig->m_camera,pRefImage->width,pRefImage->height);
-	raypoint = pConfig->m_camera.global_view.Untransform(raypoint); // camera to world
-	direction = raypoint - cam_pos; // create a vector
-	direction.Normalize(); //and normalize it to a length of 1 
+	GetRay(pos,&cam_pos,&direction);
 	// now intersect this with the plane and take that point
 	if(IntersectPlane(plane,&cam_pos,&direction,pnt_intersect))
 	{
@@ -55,9 +281,100 @@ bool ScannerAlg::PlaneIntersect(Plane *plane,Point2D pos,point_3d *pnt_intersect
 	return retval;
 }
 
+/*
+Get the normalized world space ray from the camera through a screen position
+*/
+void ScannerAlg::GetRay(Point2D &pos,point_3d *cam_pos,Vector3d *direction)
+{
+	point_3d raypoint; // a point we use to create the ray
+	// use the Camera world Z cordinate to unproject
+	raypoint.Cz = 1; // look into the sceen
+	IplImage *pRefImage = ImProc::Instance()->GetCurFrameGrey();
+	UnProject(pos,&raypoint,&pConfig->m_camera,pRefImage->width,pRefImage->height);
+	raypoint = pConfig->m_camera.global_view.Untransform(raypoint); // camera to world
+	*direction = raypoint - *cam_pos; // create a vector
+	direction->Normalize(); //and normalize it to a length of 1 
+}
+
+/*
+Batched version of PlaneIntersect
+Intersects the first n screen positions in m_batchpos with the plane,
+the results are left in m_batchx/y/z, and m_batchmask is set for
+each valid intersection. Returns the number of valid intersections.
+*/
+int ScannerAlg::PlaneIntersectBatch(Plane *plane,int n)
+{
+	point_3d cam_pos; //position of the camera
+	Vector3d direction;
+	pConfig->m_camera.GetPosition(&cam_pos);
+	for(int i = 0; i < n; i++)
+	{
+		GetRay(m_batchpos[i],&cam_pos,&direction);
+		m_batchdx[i] = direction.x;
+		m_batchdy[i] = direction.y;
+		m_batchdz[i] = direction.z;
+	}
+	return IntersectPlaneBatch(plane,&cam_pos,m_batchdx,m_batchdy,m_batchdz,n,
+		m_batchx,m_batchy,m_batchz,m_batchmask);
+}
+
 
 
 
+/*
+Look up the colors of the first n intersected points in m_batchpos all at once
+(after PlaneIntersectBatch, only where m_batchmask is set) into m_batchcolor
+returns false if the config says not to color the points
+*/
+bool ScannerAlg::GatherBatchColors(int n)
+{
+	if(pConfig->m_colorsource == eColorNone)
+		return false;
+	ImProc::Instance()->GatherColors(m_batchpos,m_batchmask,n,m_batchcolor,pConfig->m_colorsource == eColorReference);
+	return true;
+}
+
+/*
+How much to trust each of the first n points of the batch when the frames
+are merged (after PlaneIntersectBatch, only where m_batchmask is set) into
+m_batchweight. It's the product of
+	the brightness of the diff image at the hit, a faint line is moved more by noise
+	one over the width of the peak along the search line, a sharp peak is placed better
+	the cosine between the ray and the laser plane's normal, at grazing angles a small
+		error in the hit or the plane moves the point a long way along the ray
+	planefit, how well the laser plane itself was found (1 = exactly)
+returns false if the config says not to weigh the points
+*/
+bool ScannerAlg::WeighBatch(IplImage *diffFrame,Plane *plane,int n,float planefit)
+{
+	if(!pConfig->m_weightpoints)
+		return false;
+	float nlen = sqrtf(plane->a * plane->a + plane->b * plane->b + plane->c * plane->c);
+	unsigned char *data = (unsigned char *)diffFrame->imageData;
+	unsigned char threshold = pConfig->m_brightnessthreshold;
+	//step along the row or down the column, the same way the laser was searched for
+	int step = m_searchrows ? 1 : diffFrame->widthStep;
+	for(int i = 0; i < n; i++)
+	{
+		if(!m_batchmask[i])
+			continue;
+		int along = m_searchrows ? m_batchpos[i].X : m_batchpos[i].Y;
+		unsigned char *hit = data + (m_batchpos[i].Y * diffFrame->widthStep) + m_batchpos[i].X;
+		//the run of pixels over the threshold the hit is in
+		int lo = 0,hi = 0;
+		while(lo < PEAK_MAX_HALFWIDTH && along - lo > 0 && hit[-(lo + 1) * step] >= threshold)
+			lo++;
+		while(hi < PEAK_MAX_HALFWIDTH && along + hi + 1 < m_linelength && hit[(hi + 1) * step] >= threshold)
+			hi++;
+		float weight = (*hit / 255.0f) * planefit / (float)(lo + hi + 1);
+		float dlen = sqrtf(m_batchdx[i] * m_batchdx[i] + m_batchdy[i] * m_batchdy[i] + m_batchdz[i] * m_batchdz[i]);
+		if(nlen > 0 && dlen > 0)
+			weight *= fabsf(plane->a * m_batchdx[i] + plane->b * m_batchdy[i] + plane->c * m_batchdz[i]) / (nlen * dlen);
+		m_batchweight[i] = weight > MIN_POINT_WEIGHT ? weight : MIN_POINT_WEIGHT;
+	}
+	return true;
+}
+
 void ScannerAlg::EndScan()
 {
 	m_scanning = false;
@@ -65,30 +382,129 @@ void ScannerAlg::EndScan()
 
 /*
 This function clears all the data in the frames
+Frames from this scanner's arena all go at once when it's reset,
+frames from another scanner's arena (a shared accumulator) are left to that scanner.
+A scanner publishing to a shared accumulator isn't its reader, so it leaves the
+accumulator alone, and its arena is only reset once the reader has freed all of
+the frames it was handed (the next ClearData after that does it).
+The spool file, if there is one, is deleted
 */
 void ScannerAlg::ClearData()
 {
-	for(int c = 0; c< m_pFrames->Count(); c ++)
+	if(m_ownaccum)
 	{
-		ScannerFrame *sf = (ScannerFrame *)m_pFrames->GetItem(c);
-		delete sf; // free up the memory
+		CollectFrames(); // pick up anything still waiting to be collected
+		m_pAccum->ResetCounts();
 	}
+	for(int c = 0; c < m_pFrames->Count(); c++)
+		ScannerFrame::Free(m_pFrames->GetItem(c));
 	m_pFrames->Destroy(); //remove all entries in the list
+	if(m_arena.LiveFrames() == 0)
+		m_arena.Reset();
+	m_live.Clear();
+	m_spool.Remove();
+	m_spooled = 0;
+}
+
+int ScannerAlg::SpoolFrames()
+{
+	if(m_ownaccum)
+		CollectFrames();
+	if(!m_spool.IsOpen())
+	{
+		bool ok;
+		if(m_spooled == 0)
+		{
+			IplImage *ref = ImProc::Instance()->GetReference();
+			ok = ref != 0 && m_spool.CreateTemp(ref->width,ref->height);
+		}
+		else
+			ok = m_spool.Append(); // a reader had it open
+		if(!ok)
+			return -1;
+	}
+	Array<ScanPoint> pnts;
+	int total = 0;
+	for(int c = 0; c < m_pFrames->Count(); c++)
+	{
+		ScannerFrame *sf = m_pFrames->GetItem(c);
+		pnts.Clear();
+		pnts.Reserve(sf->m_pPoints->Count());
+		for(int p = 0; p < sf->m_pPoints->Count(); p++)
+		{
+			ScanPoint sp;
+			sp.FromPoint3d(sf->m_pPoints->GetItem(p));
+			pnts.Add(sp);
+		}
+		if(!m_spool.WriteFrame(pnts.Data(),pnts.Count()))
+		{
+			//out of disk, the rest of the frames stay in memory
+			for(int r = 0; r < c; r++)
+				m_pFrames->RemoveAtOrdered(0);
+			return -1;
+		}
+		total += pnts.Count();
+		m_spooled++;
+		ScannerFrame::Free(sf);
+	}
+	// like ClearData, but the frame counts and the live merge keep going
+	m_pFrames->Clear();
+	if(m_arena.LiveFrames() == 0)
+		m_arena.Reset(); // not if a reader still has some of this scanner's frames
+	return total;
+}
+
+bool ScannerAlg::OpenSpool(ScanSpool *reader)
+{
+	if(m_spooled == 0)
+		return false;
+	m_spool.Close(); // fills in the header counts
+	return reader->Open(m_spool.FileName());
+}
+
+/*
+The new frames are added to the live merge as they're collected. If the
+image size has changed it starts over from the frames still in memory,
+unless some have been spooled. Those are only in the merge now, so it
+keeps its size and the frames at the new size are clipped to it
+*/
+int ScannerAlg::CollectFrames()
+{
+	if(!m_ownaccum)
+		return 0; // only the accumulator's reader may collect
+	int first = m_pFrames->Count();
+	int num = m_pAccum->Collect(m_pFrames);
+	IplImage *ref = ImProc::Instance()->GetReference();
+	if(ref != 0 && (ref->width != m_live.Width() || ref->height != m_live.Height()) && m_spooled == 0)
+	{
+		m_live.Resize(ref->width,ref->height);
+		first = 0;
+	}
+	for(int c = first; c < m_pFrames->Count(); c++)
+		m_live.AddFrame(m_pFrames->GetItem(c));
+	return num;
+}
+
+/*
+Use a shared accumulator, anything published to the old one is collected first
+*/
+void ScannerAlg::SetAccumulator(FrameAccumulator *accum)
+{
+	if(m_ownaccum)
+	{
+		CollectFrames();
+		delete m_pAccum;
+	}
+	m_pAccum = accum;
+	m_ownaccum = false;
 }
 
 /*
-Assumes BGR image
+Get the color of the current frame at the specified position
+ImProc takes care of converting it if the camera isn't giving us BGR
 */
 Color ScannerAlg::GetColor(int xpos,int ypos)
 {
-	Color tmp;
-	//look at the color reference image and get the specified color
-	IplImage *pRefImage = ImProc::Instance()->GetCurFrame();
-	int widthstep = pRefImage->widthStep;
-	unsigned char * dat = (unsigned char *)pRefImage->imageData;
-	tmp.B = dat[(ypos * widthstep) + (xpos*3)];
-	tmp.G = dat[(ypos * widthstep) + (xpos*3)+1];
-	tmp.R = dat[(ypos * widthstep) + (xpos*3)+2];
-	return tmp;
+	return ImProc::Instance()->GetColor(xpos,ypos);
 }
 
@@ -6,6 +6,11 @@
 #include "point3d.hpp"
 #include "ScannerFrame.h"
 #include "plane.h"
+#include "LaserTracker.h"
+#include "FrameAccumulator.h"
+#include "ScanArena.h"
+#include "ScanSpool.h"
+#include "LiveMerge.h"
 
 /*
 A little about this algorithm:
@@ -32,7 +37,8 @@ class ScannerAlg
 private:
 	bool m_scanning;
 public:
-	List *m_pFrames; // list of frames generated
+	Array<ScannerFrame *> *m_pFrames; // list of frames generated, call CollectFrames first to bring it up to date
+	LaserTracker m_tracker; // predicts where the laser is on each line
 
 	ScannerConfig *pConfig;
 	ScannerAlg();
@@ -43,6 +49,8 @@ public:
 	bool IsScanning(){return m_scanning;}
 	virtual void ProcessFrame(float zrot){}	
 	virtual int FindLaser(IplImage *diffFrame, int pos){return 0;}
+	// same as above, but only looks between start and end (exclusive) along the line
+	virtual int FindLaser(IplImage *diffFrame, int pos, int start, int end){return -1;}
 	virtual bool FindLaserPlane(IplImage *diffFrame, Plane *pl){return false;}
 	virtual void EndScan();
 	virtual void CreateDefaultConfiguration(){}
@@ -50,5 +58,63 @@ public:
 	virtual bool LoadConfiguration(){return false;}
 
 	bool PlaneIntersect(Plane *plane,Point2D pos,point_3d *pnt_intersect);
+	int PlaneIntersectBatch(Plane *plane,int n);
 	void ClearData();
+	/*
+	write the frames collected so far to this scan's spool file and free them,
+	so a long session doesn't have to fit in memory (see StreamMerger).
+	The file is made in the temp folder the first time and deleted by ClearData.
+	Like ClearData, call it between frames from the thread that runs the scan.
+	returns the number of points written, -1 if the spool can't be written
+	*/
+	int SpoolFrames();
+	bool IsSpooled(){return m_spooled > 0;}
+	/*
+	open the spooled frames for reading, the next SpoolFrames appends to
+	the same file, so close the reader before then
+	*/
+	bool OpenSpool(ScanSpool *reader);
+	size_t MemoryUsed(){return m_arena.BytesUsed();} // by the frames and points of this scan
+	// move the frames published by ProcessFrame into m_pFrames (reader thread only)
+	int CollectFrames();
+	// the per pixel merge of everything collected this scan, spooled frames included
+	LiveMerge *GetLiveMerge(){return &m_live;}
+	/*
+	several ScannerAlgs working on different frames can share one accumulator,
+	the one that made it is the reader, the others only publish to it
+	(CollectFrames, ClearData and SpoolFrames leave a shared accumulator alone)
+	*/
+	void SetAccumulator(FrameAccumulator *accum);
+	FrameAccumulator *GetAccumulator(){return m_pAccum;}
+protected:
+	FrameAccumulator *m_pAccum; // where ProcessFrame publishes finished frames
+	ScanArena m_arena; // the frames and points of the current scan
+	LiveMerge m_live; // updated by CollectFrames
+	ScanSpool m_spool; // written by SpoolFrames
+	int m_spooled; // frames written out by SpoolFrames since ClearData
+	bool m_ownaccum;
+	// scratch buffers for PlaneIntersectBatch, fill m_batchpos then read m_batchx/y/z where m_batchmask is set
+	Point2D *m_batchpos;
+	float *m_batchdx,*m_batchdy,*m_batchdz;
+	float *m_batchx,*m_batchy,*m_batchz;
+	unsigned char *m_batchmask;
+	Color *m_batchcolor;
+	float *m_batchweight;
+	int m_batchsize;
+	void ReserveBatch(int n);
+	bool GatherBatchColors(int n);
+	bool WeighBatch(IplImage *diffFrame,Plane *plane,int n,float planefit);
+	void GetRay(Point2D &pos,point_3d *cam_pos,Vector3d *direction);
+	// per frame laser search, see ScannerConfig::m_searchstrategy
+	int *m_roilast; // eSearchROI, last frame's hit on each line (-1 = none)
+	int *m_coarsehit; // eSearchPyramid, hit on each downsampled line this frame (-2 = not searched yet)
+	IplImage *m_coarse; // eSearchPyramid, the downsampled diff image for this frame
+	int m_numlines;
+	int m_linelength;
+	bool m_searchrows; // the lines are rows of the image (false = columns)
+	void BeginSearch(IplImage *diffFrame,bool rows);
+	void EndSearch();
+	int TrackLaser(IplImage *diffFrame,int line);
+	int ROILaser(IplImage *diffFrame,int line);
+	int PyramidLaser(IplImage *diffFrame,int line);
 };
@@ -6,6 +6,7 @@
 ScannerAlgCorner::ScannerAlgCorner(void)
 {
 	pConfig = new ScannerConfigCorner();	
+	m_inlierratio = 0.0f;
 }
 
 ScannerAlgCorner::~ScannerAlgCorner(void)
@@ -28,42 +29,56 @@ void ScannerAlgCorner::ProcessFrame(float zrot)
 
 	//frame has already been converted to greyscale or canny here
 	Plane laserplane;
+	BeginSearch(diffImage,false);
 	if(FindLaserPlane(diffImage,&laserplane))
 	{
 		//create a new scanner frame to hold some data
-		ScannerFrame *sf = new ScannerFrame();
+		ScannerFrame *sf = new(m_arena) ScannerFrame(&m_arena);
 		sf->m_zrot = zrot;
 		Point2D p2d; // a temporariy 2d point
-		point_3d intersectcurrent; // the solved point of intersection
+		int numfound = 0; // number of columns where the laser was found
 
 		//alright, we've found the plane of the laser
-		//now iterate through and determine the 3d points
+		//now iterate through and find the laser in each column
+		ReserveBatch(diffImage->width);
 		for(p2d.X = SCANNERINSET; p2d.X < diffImage->width - SCANNERINSET ; p2d.X++)
 		{
-			p2d.Y = FindLaser(diffImage,p2d.X);
+			p2d.Y = TrackLaser(diffImage,p2d.X);
 			if(p2d.Y == -1)
 				continue; // skip, no laser found
-
-			if(PlaneIntersect(&laserplane,p2d,&intersectcurrent))
-			{
-				//we should probably check to see that the point isn't waaaaay off in the distance
-				//create a new point
-				point_3d *saved = new point_3d(intersectcurrent.Wx,intersectcurrent.Wy,intersectcurrent.Wz);
-				saved->m_p2d = p2d; // save the original 2d position for later optimization
-				saved->m_color = GetColor(p2d.X,p2d.Y); // get the color value
-				sf->m_pPoints->Add(saved);
-			}
+			m_batchpos[numfound++] = p2d;
+		}
+		//then determine the 3d points all at once
+		PlaneIntersectBatch(&laserplane,numfound);
+		//and look up all of their colors
+		bool colored = GatherBatchColors(numfound);
+		//and how much each one can be trusted
+		bool weighted = WeighBatch(diffImage,&laserplane,numfound,m_inlierratio);
+		for(int i = 0; i < numfound; i++)
+		{
+			if(!m_batchmask[i])
+				continue; // parallel or behind the camera
+			//we should probably check to see that the point isn't waaaaay off in the distance
+			//create a new point
+			point_3d *saved = new(m_arena) point_3d(m_batchx[i],m_batchy[i],m_batchz[i]);
+			saved->m_p2d = m_batchpos[i]; // save the original 2d position for later optimization
+			if(colored)
+				saved->m_color = m_batchcolor[i];
+			if(weighted)
+				saved->m_weight = m_batchweight[i];
+			sf->m_pPoints->Add(saved);
 		}
 		if(sf->m_pPoints->Count() > 0)
 		{
-			m_pFrames->Add(sf);
+			m_pAccum->Publish(sf); // hand it off to whoever is collecting
 		}
 		else
 		{
-			//no data in this frame
-			delete sf;
+			//no data in this frame, the arena gets it back at the end of the scan
+			ScannerFrame::Free(sf);
 		}
 	}
+	EndSearch();
 }
 
 
@@ -79,6 +94,12 @@ void ScannerAlgCorner::ProcessFrame(float zrot)
 */
 
 int ScannerAlgCorner::FindLaser(IplImage *diffFrame, int xpos)
+{
+	return FindLaser(diffFrame,xpos,0,diffFrame->height);
+}
+
+// only look at the pixels from start up to end on the column
+int ScannerAlgCorner::FindLaser(IplImage *diffFrame, int xpos, int start, int end)
 {
 	//get a pointer to the data
 	unsigned char *data = (unsigned char *)diffFrame->imageData;
@@ -87,7 +108,7 @@ int ScannerAlgCorner::FindLaser(IplImage *diffFrame, int xpos)
 	unsigned char brightest = 0 ;
 	int brightestYpos  = -1;
 
-	for(int ypos = 0 ; ypos < diffFrame->height; ypos++)
+	for(int ypos = start ; ypos < end; ypos++)
 	{
 		dat = data[(ypos * diffFrame->widthStep) + xpos]; // current pixel data
 		if(dat >= pConfig->m_brightnessthreshold)
@@ -111,60 +132,67 @@ int ScannerAlgCorner::FindLaser(IplImage *diffFrame, int xpos)
 /*
  look at the left SCANNERINSET pixels
  find the positions
- throw out any outliers
- generate a least squares line that describes the line
+ fit a line with RANSAC, throwing out any outliers
  pick 2 points from that line 
  do the same for the right side
  pick 2 points
  convert to screen->camera->world
  use the world points to generate the plane
+ if m_fit3d is set, all of the points are intersected with the corner
+ planes and the laser plane is fit to them directly instead
+ the frame is rejected if the inlier ratio is too low
 */
 bool ScannerAlgCorner::FindLaserPlane(IplImage *diffFrame, Plane *pl)
 {
-
-	List leftpnts,rightpnts;
+	ScannerConfigCorner *cfg = (ScannerConfigCorner *)pConfig;
 	float left_m,left_b,right_m,right_b;
-	Point2D left_tmppnts[SCANNERINSET];
-	Point2D right_tmppnts[SCANNERINSET];
+	Point2D leftpnts[SCANNERINSET];
+	Point2D rightpnts[SCANNERINSET];
+	int numleft = 0,numright = 0;
 	Point2D L1,L2,R1,R2; // the line segment that describes the slope on the left
+	m_inlierratio = 0.0f;
 	for(int xpos = 0; xpos <SCANNERINSET ; xpos ++)
 	{
-		int l_ypos = FindLaser(diffFrame,xpos); // the left side
-		int r_ypos = FindLaser(diffFrame,xpos + (diffFrame->width - SCANNERINSET )); // the right side
+		int l_ypos = TrackLaser(diffFrame,xpos); // the left side
+		int r_ypos = TrackLaser(diffFrame,xpos + (diffFrame->width - SCANNERINSET )); // the right side
 		if(l_ypos != -1)
-		{
-			left_tmppnts[xpos].Set(xpos,l_ypos);
-			leftpnts.Add(&left_tmppnts[xpos]); // add only valid points
-		}
+			leftpnts[numleft++].Set(xpos,l_ypos); // add only valid points
 		if(r_ypos != -1)
-		{
-			right_tmppnts[xpos].Set(xpos + (diffFrame->width - SCANNERINSET ),r_ypos);
-			rightpnts.Add(&right_tmppnts[xpos]); // add only valid points
-		}
+			rightpnts[numright++].Set(xpos + (diffFrame->width - SCANNERINSET ),r_ypos);
 	}
-	//we should check the list here and see if there are enough points to determine a plane
-	if(leftpnts.Count() < (SCANNERINSET/2)) // not enough points to get a good slope
+	//check here and see if there are enough points to determine a plane
+	if(numleft < (SCANNERINSET/2) || numright < (SCANNERINSET/2)) // not enough points to get a good slope
+		return false;
+	if(cfg->m_fit3d)
+	{
+		//put all of the points on the corner planes, then fit the laser plane to them
+		point_3d vertices[SCANNERINSET * 2];
+		int numverts = 0;
+		for(int i = 0; i < numleft; i++)
+			if(PlaneIntersect(&cfg->m_leftcorner,leftpnts[i],&vertices[numverts]))
+				numverts++;
+		for(int i = 0; i < numright; i++)
+			if(PlaneIntersect(&cfg->m_rightcorner,rightpnts[i],&vertices[numverts]))
+				numverts++;
+		m_inlierratio = FindRobustPlane(vertices,numverts,cfg->m_ransactolerance3d,cfg->m_ransaciterations,pl);
+		if(numverts < numleft + numright)
+			m_inlierratio = (m_inlierratio * numverts) / (numleft + numright);
+		return m_inlierratio >= cfg->m_mininlierratio;
+	}
+	float left_ratio = FindRobustLine(leftpnts,numleft,cfg->m_ransactolerance2d,cfg->m_ransaciterations,&left_m,&left_b); // find the slope
+	float right_ratio = FindRobustLine(rightpnts,numright,cfg->m_ransactolerance2d,cfg->m_ransaciterations,&right_m,&right_b);
+	m_inlierratio = left_ratio < right_ratio ? left_ratio : right_ratio;
+	if(m_inlierratio < cfg->m_mininlierratio) // too many outliers, the line is probably not the laser
 		return false;
-	// we should probably check for outliers as well to make sure it's a good slope
-	FindLeastSquare(&leftpnts,&left_m,&left_b); // find the slope
 	L1.Set(0,(left_m * 0) + left_b);
 	L2.Set(100,(left_m * 100) + left_b);
 	//and for the right side
-
-	if(rightpnts.Count() < (SCANNERINSET/2)) // not enough points to get a good slope
-		return false;
-	// we should probably check for outliers as well to make sure it's a good slope
-	FindLeastSquare(&rightpnts,&right_m,&right_b); // find the slope
 	R1.Set((diffFrame->width - 100),(right_m * (diffFrame->width - 100)) + right_b);
 	R2.Set(diffFrame->width,(right_m * diffFrame->width) + right_b);
-	//clear the lists
-	leftpnts.Destroy();
-	rightpnts.Destroy();
 	// now we've got 4 points, 2 from the left plane, 2 from the right
 	// unproject them to go from screen-camera
 	point_3d vertices[4];
 	//order L1 - L2 - R1 - R2
-	ScannerConfigCorner *cfg = (ScannerConfigCorner *)pConfig;
 	// then untransform them to go from camera to world
 	if(!PlaneIntersect(&cfg->m_leftcorner,L1,&vertices[0]))
 			return false;
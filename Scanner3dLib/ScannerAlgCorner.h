@@ -6,11 +6,13 @@
 class ScannerAlgCorner : public ScannerAlg
 {
 public:
+	float m_inlierratio; // inlier ratio of the last laser plane fit
 
 	ScannerAlgCorner(void);
 	~ScannerAlgCorner(void);
 	void ProcessFrame(float zrot);
 	int FindLaser(IplImage *diffFrame, int pos);
+	int FindLaser(IplImage *diffFrame, int pos, int start, int end);
 	bool FindLaserPlane(IplImage *diffFrame, Plane *pl);
 	void CreateDefaultConfiguration();
 	bool SaveConfiguration();
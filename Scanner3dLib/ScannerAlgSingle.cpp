@@ -18,42 +18,56 @@ void ScannerAlgSingle::ProcessFrame(float zrot)
 	if(diffImage == 0) // must be first frame, bail
 		return;
 	Plane laserplane;
+	BeginSearch(diffImage,true);
 	if(FindLaserPlane(diffImage,&laserplane))
 	{
 		//create a new scanner frame to hold some data
-		ScannerFrame *sf = new ScannerFrame();
+		ScannerFrame *sf = new(m_arena) ScannerFrame(&m_arena);
 		sf->m_zrot = zrot;
 		Point2D p2d; // a temporariy 2d point
-		point_3d intersectcurrent; // the solved point of intersection
+		int numfound = 0; // number of lines where the laser was found
 
 		//alright, we've found the plane of the laser
-		//now iterate through and determine the 3d points
+		//now iterate through and find the laser on each line
+		ReserveBatch(diffImage->height);
 		for(p2d.Y = 25; p2d.Y < diffImage->height;p2d.Y++)
 		{
-			p2d.X = FindLaser(diffImage,p2d.Y);
+			p2d.X = TrackLaser(diffImage,p2d.Y);
 			if(p2d.X == -1)
 				continue; // skip, no laser found
-
-			if(PlaneIntersect(&laserplane,p2d,&intersectcurrent))
-			{
-				//we should probably check to see that the point isn't waaaaay off in the distance
-				//create a new point
-				point_3d *saved = new point_3d(intersectcurrent.Wx,intersectcurrent.Wy,intersectcurrent.Wz);
-				saved->m_p2d = p2d; // save the original 2d position for later optimization
-				saved->m_color = GetColor(p2d.X,p2d.Y); // get the color value
-				sf->m_pPoints->Add(saved);
-			}
+			m_batchpos[numfound++] = p2d;
+		}
+		//then determine the 3d points all at once
+		PlaneIntersectBatch(&laserplane,numfound);
+		//and look up all of their colors
+		bool colored = GatherBatchColors(numfound);
+		//and how much each one can be trusted
+		bool weighted = WeighBatch(diffImage,&laserplane,numfound,1.0f); // the plane is made from 3 points, there is no fit to go by
+		for(int i = 0; i < numfound; i++)
+		{
+			if(!m_batchmask[i])
+				continue; // parallel or behind the camera
+			//we should probably check to see that the point isn't waaaaay off in the distance
+			//create a new point
+			point_3d *saved = new(m_arena) point_3d(m_batchx[i],m_batchy[i],m_batchz[i]);
+			saved->m_p2d = m_batchpos[i]; // save the original 2d position for later optimization
+			if(colored)
+				saved->m_color = m_batchcolor[i];
+			if(weighted)
+				saved->m_weight = m_batchweight[i];
+			sf->m_pPoints->Add(saved);
 		}
 		if(sf->m_pPoints->Count() > 0)
 		{
-			m_pFrames->Add(sf);
+			m_pAccum->Publish(sf); // hand it off to whoever is collecting
 		}
 		else
 		{
-			//no data in this frame
-			delete sf;
+			//no data in this frame, the arena gets it back at the end of the scan
+			ScannerFrame::Free(sf);
 		}
 	}
+	EndSearch();
 }
 /*
 	Find the x position of the laser on the specified y line
@@ -66,6 +80,12 @@ void ScannerAlgSingle::ProcessFrame(float zrot)
 */
 
 int ScannerAlgSingle::FindLaser(IplImage *diffFrame, int ypos)
+{
+	return FindLaser(diffFrame,ypos,0,diffFrame->width);
+}
+
+// only look at the pixels from start up to end on the line
+int ScannerAlgSingle::FindLaser(IplImage *diffFrame, int ypos, int start, int end)
 {
 	//get a pointer to the data
 	unsigned char *data = (unsigned char *)diffFrame->imageData;
@@ -74,7 +94,7 @@ int ScannerAlgSingle::FindLaser(IplImage *diffFrame, int ypos)
 	unsigned char brightest = 0 ;
 	int brightestXpos  = -1;
 
-	for(int xpos = 0 ; xpos < diffFrame->width; xpos++)
+	for(int xpos = start ; xpos < end; xpos++)
 	{
 		dat = data[(ypos * diffFrame->widthStep) + xpos]; // current pixel data
 		if(dat >= pConfig->m_brightnessthreshold)
@@ -118,7 +138,7 @@ bool ScannerAlgSingle::FindLaserPlane(IplImage *diffFrame, Plane *pl)
 
 	for (int y =0 ;y < 25 ; y++)
 	{
-		top25Xpos[y] = FindLaser(diffFrame,y);
+		top25Xpos[y] = TrackLaser(diffFrame,y);
 		if(top.X == -1)
 		{
 			if(top25Xpos[y] != -1)
@@ -15,6 +15,7 @@ public:
 	~ScannerAlgSingle(void);
 	void ProcessFrame(float zrot);
 	int FindLaser(IplImage *diffFrame, int pos);
+	int FindLaser(IplImage *diffFrame, int pos, int start, int end);
 	bool FindLaserPlane(IplImage *diffFrame, Plane *pl);
 	void CreateDefaultConfiguration();
 	bool SaveConfiguration();
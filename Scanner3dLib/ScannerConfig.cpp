@@ -1,9 +1,27 @@
 
 #include "ScannerConfig.h"
+#include "improc.h"
 
 ScannerConfig::ScannerConfig(void)
 {
-
+	m_searchstrategy = eSearchTracked;
+	m_roiwindow = 16;
+	m_pyramidlevels = 2;
+	m_capturewidth = 640;
+	m_captureheight = 480;
+	m_capturefps = 0;
+	m_captureformat = ePixelBGR;
+	m_colorsource = eColorFrame;
+	m_filtermindepth = 0;
+	m_filtermaxdepth = 0;
+	m_filterradius = 0;
+	m_filterminneighbors = 4;
+	m_filterstatk = 0; // all off, the export keeps every point until a filter is set up
+	m_filterstddev = 3.0f;
+	m_filtervoxel = 0;
+	m_spoolbudgetmb = 256;
+	m_mergebudgetmb = 64;
+	m_weightpoints = true;
 }
 
 ScannerConfig::~ScannerConfig(void)
@@ -32,3 +50,66 @@ bool ScannerConfig::Load(FILE *fp)
 	fread(&m_canny_apertureSize,sizeof(m_canny_apertureSize),1,fp);
 	return true;
 }
+
+void ScannerConfig::SaveOptions(FILE *fp)
+{
+	int strategy = m_searchstrategy;
+	fwrite(&strategy,sizeof(strategy),1,fp);
+	fwrite(&m_roiwindow,sizeof(m_roiwindow),1,fp);
+	fwrite(&m_pyramidlevels,sizeof(m_pyramidlevels),1,fp);
+	int format = m_captureformat;
+	fwrite(&m_capturewidth,sizeof(m_capturewidth),1,fp);
+	fwrite(&m_captureheight,sizeof(m_captureheight),1,fp);
+	fwrite(&m_capturefps,sizeof(m_capturefps),1,fp);
+	fwrite(&format,sizeof(format),1,fp);
+	int colorsource = m_colorsource;
+	fwrite(&colorsource,sizeof(colorsource),1,fp);
+	fwrite(&m_filtermindepth,sizeof(m_filtermindepth),1,fp);
+	fwrite(&m_filtermaxdepth,sizeof(m_filtermaxdepth),1,fp);
+	fwrite(&m_filterradius,sizeof(m_filterradius),1,fp);
+	fwrite(&m_filterminneighbors,sizeof(m_filterminneighbors),1,fp);
+	fwrite(&m_filterstatk,sizeof(m_filterstatk),1,fp);
+	fwrite(&m_filterstddev,sizeof(m_filterstddev),1,fp);
+	fwrite(&m_filtervoxel,sizeof(m_filtervoxel),1,fp);
+	fwrite(&m_spoolbudgetmb,sizeof(m_spoolbudgetmb),1,fp);
+	fwrite(&m_mergebudgetmb,sizeof(m_mergebudgetmb),1,fp);
+	fwrite(&m_weightpoints,sizeof(m_weightpoints),1,fp);
+}
+
+void ScannerConfig::LoadOptions(FILE *fp)
+{
+	int strategy = m_searchstrategy;
+	if(fread(&strategy,sizeof(strategy),1,fp) == 1)
+		m_searchstrategy = (eSearchStrategy)strategy;
+	fread(&m_roiwindow,sizeof(m_roiwindow),1,fp);
+	fread(&m_pyramidlevels,sizeof(m_pyramidlevels),1,fp);
+	int format = m_captureformat;
+	fread(&m_capturewidth,sizeof(m_capturewidth),1,fp);
+	fread(&m_captureheight,sizeof(m_captureheight),1,fp);
+	fread(&m_capturefps,sizeof(m_capturefps),1,fp);
+	if(fread(&format,sizeof(format),1,fp) == 1)
+		m_captureformat = (ePixelFormat)format;
+	int colorsource = m_colorsource;
+	if(fread(&colorsource,sizeof(colorsource),1,fp) == 1)
+		m_colorsource = (eColorSource)colorsource;
+	fread(&m_filtermindepth,sizeof(m_filtermindepth),1,fp);
+	fread(&m_filtermaxdepth,sizeof(m_filtermaxdepth),1,fp);
+	fread(&m_filterradius,sizeof(m_filterradius),1,fp);
+	fread(&m_filterminneighbors,sizeof(m_filterminneighbors),1,fp);
+	fread(&m_filterstatk,sizeof(m_filterstatk),1,fp);
+	fread(&m_filterstddev,sizeof(m_filterstddev),1,fp);
+	fread(&m_filtervoxel,sizeof(m_filtervoxel),1,fp);
+	fread(&m_spoolbudgetmb,sizeof(m_spoolbudgetmb),1,fp);
+	fread(&m_mergebudgetmb,sizeof(m_mergebudgetmb),1,fp);
+	fread(&m_weightpoints,sizeof(m_weightpoints),1,fp);
+	if(m_roiwindow < 1)
+		m_roiwindow = 1;
+	if(m_pyramidlevels < 1)
+		m_pyramidlevels = 1;
+	if(m_pyramidlevels > IMPROC_MAX_PYRAMID)
+		m_pyramidlevels = IMPROC_MAX_PYRAMID;
+	if(m_spoolbudgetmb < 0)
+		m_spoolbudgetmb = 0;
+	if(m_mergebudgetmb < 1)
+		m_mergebudgetmb = 1;
+}
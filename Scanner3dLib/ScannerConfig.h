@@ -5,6 +5,7 @@
 #include "plane.h"
 #include "camera.h"
 #include "point3d.hpp"
+#include "CaptureFormat.h"
 
 enum eScantype
 {
@@ -12,6 +13,23 @@ enum eScantype
 	eLeftRightCorner = 1, // look on the left, right side of the object for laser line
 };
 
+// how the laser is searched for on each line of the diff image
+enum eSearchStrategy
+{
+	eSearchFull = 0, // scan every line end to end
+	eSearchTracked = 1, // search a band around the laser predicted by the LaserTracker
+	eSearchROI = 2, // search a window around last frame's hit, growing it on a miss
+	eSearchPyramid = 3, // find the laser on a downsampled diff image, then refine at full size
+};
+
+// where the color of the scanned points comes from
+enum eColorSource
+{
+	eColorNone = 0, // geometry only, points are left grey
+	eColorFrame = 1, // the frame the laser was found in
+	eColorReference = 2, // the reference image taken with no laser, so colors aren't tinted
+};
+
 class ScannerConfig
 {
 public:
@@ -32,6 +50,35 @@ public:
 
 	eScantype m_scantype;
 
+	eSearchStrategy m_searchstrategy;
+	int m_roiwindow; // half width in pixels of the first eSearchROI window
+	int m_pyramidlevels; // eSearchPyramid downsamples by 2^m_pyramidlevels (1 - 3)
+
+	// what to ask the camera for, see ImProc::StartVideo
+	int m_capturewidth;
+	int m_captureheight;
+	double m_capturefps; // 0 = camera default
+	ePixelFormat m_captureformat;
+
+	eColorSource m_colorsource;
+
+	// export clean up, see PointFilter (0 switches a stage off)
+	float m_filtermindepth; // distance from the camera, mm
+	float m_filtermaxdepth;
+	float m_filterradius; // radius outlier removal
+	int m_filterminneighbors;
+	int m_filterstatk; // statistical outlier removal
+	float m_filterstddev;
+	float m_filtervoxel; // voxel downsampling, mm
+
+	// long scans, see ScannerAlg::SpoolFrames and StreamMerger
+	int m_spoolbudgetmb; // frames kept in memory before they go to disk, 0 = never spool
+	int m_mergebudgetmb; // memory for merging a spooled scan
+
+	// weigh each point by how clearly the laser was seen when merging (see ScannerAlg::WeighBatch),
+	// false merges with a plain average
+	bool m_weightpoints;
+
 	ScannerConfig(void);
 	~ScannerConfig(void);
 
@@ -40,4 +87,9 @@ public:
 
 	virtual bool Save(FILE *fp);
 	virtual bool Load(FILE *fp);
+protected:
+	// the search and capture options are appended by the derived classes after their own data
+	// so config files saved before they existed still load
+	void SaveOptions(FILE *fp);
+	void LoadOptions(FILE *fp);
 };
@@ -25,6 +25,11 @@ void ScannerConfigCorner::CreateDefault()
 	Vector3d up;
 	up.Set(0,0,1);
 	m_camera.LookAt(&lookat,&up);
+	m_fit3d = false;
+	m_ransactolerance2d = 2.0f;
+	m_ransactolerance3d = 1.0f;
+	m_ransaciterations = 32;
+	m_mininlierratio = 0.6f;
 	/*
 	(right)
 		+Y
@@ -42,6 +47,12 @@ bool ScannerConfigCorner::Save(FILE *fp)
 {
 	m_leftcorner.Save(fp);
 	m_rightcorner.Save(fp);	
+	fwrite(&m_fit3d,sizeof(m_fit3d),1,fp);
+	fwrite(&m_ransactolerance2d,sizeof(m_ransactolerance2d),1,fp);
+	fwrite(&m_ransactolerance3d,sizeof(m_ransactolerance3d),1,fp);
+	fwrite(&m_ransaciterations,sizeof(m_ransaciterations),1,fp);
+	fwrite(&m_mininlierratio,sizeof(m_mininlierratio),1,fp);
+	SaveOptions(fp);
 	return true;
 }
 
@@ -49,5 +60,12 @@ bool ScannerConfigCorner::Load(FILE * fp)
 {
 	m_leftcorner.Load(fp);
 	m_rightcorner.Load(fp);
+	// older config files end here, the defaults are kept for anything not read
+	fread(&m_fit3d,sizeof(m_fit3d),1,fp);
+	fread(&m_ransactolerance2d,sizeof(m_ransactolerance2d),1,fp);
+	fread(&m_ransactolerance3d,sizeof(m_ransactolerance3d),1,fp);
+	fread(&m_ransaciterations,sizeof(m_ransaciterations),1,fp);
+	fread(&m_mininlierratio,sizeof(m_mininlierratio),1,fp);
+	LoadOptions(fp);
 	return true;
 }
\ No newline at end of file
@@ -13,6 +13,13 @@ public:
 	Plane m_leftcorner;
 	Plane m_rightcorner;
 
+	// robust fitting of the laser plane
+	bool m_fit3d; // fit the plane to the 3d points on the corner planes instead of 2 lines
+	float m_ransactolerance2d; // max distance (pixels) from the line for an inlier
+	float m_ransactolerance3d; // max distance (world units) from the plane for an inlier
+	int m_ransaciterations; // number of hypotheses to score, bounds the runtime
+	float m_mininlierratio; // frames with a lower inlier ratio are rejected
+
 	ScannerConfigCorner(void);
 	~ScannerConfigCorner(void);
 	void CreateDefault();
@@ -56,6 +56,7 @@ bool ScannerConfigSingle::Save( FILE *fp)
 	m_reference.Save(fp);
 	m_laserpos.Save(fp);
 	fwrite(&m_assumelaservertical,sizeof(m_assumelaservertical),1,fp);
+	SaveOptions(fp);
 	return true;
 }
 
@@ -65,5 +66,6 @@ bool ScannerConfigSingle::Load(FILE *fp)
 	m_reference.Load(fp);
 	m_laserpos.Load(fp);
 	fread(&m_assumelaservertical,sizeof(m_assumelaservertical),1,fp);
+	LoadOptions(fp);
 	return true;
 }
\ No newline at end of file
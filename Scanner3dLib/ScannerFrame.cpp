@@ -2,19 +2,33 @@
 #include "ScannerFrame.h"
 #include "point3d.hpp"
 
-ScannerFrame::ScannerFrame(void)
+ScannerFrame::ScannerFrame(ScanArena *arena)
 {
-	m_pPoints = new List();
+	m_arena = arena;
+	if(arena)
+	{
+		m_pPoints = new(*arena) Array<point_3d *>(0,arena);
+		arena->FrameMade();
+	}
+	else
+		m_pPoints = new Array<point_3d *>();
 	m_zrot = 0; // assume no rotation for now.
 }
 
 ScannerFrame::~ScannerFrame(void)
 {
+	if(m_arena)
+		return; // nothing here belongs to the heap
 	// iterate through and delete all point
-	for(ListItem *li = m_pPoints->list; li !=0; li=li->next)
-	{
-		point_3d *p = (point_3d *)li->data;
-		delete p;
-	}
+	for(int c = 0; c < m_pPoints->Count(); c++)
+		delete m_pPoints->GetItem(c);
 	delete m_pPoints;
 }
+
+void ScannerFrame::Free(ScannerFrame *sf)
+{
+	if(sf->m_arena == 0)
+		delete sf;
+	else
+		sf->m_arena->FrameFreed(); // the arena can be reset once they're all freed
+}
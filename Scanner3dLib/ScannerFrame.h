@@ -1,10 +1,14 @@
 #pragma once
-#include "listitem.h"
+#include "Array.h"
+#include "point3d.hpp"
 class ScannerFrame
 {
 public:
-	List *m_pPoints;
+	Array<point_3d *> *m_pPoints;
 	float m_zrot; // zrotation
-	ScannerFrame(void);
+	ScanArena *m_arena; // the frame, its list and its points live here (0 = the heap)
+	ScannerFrame(ScanArena *arena = 0);
 	~ScannerFrame(void);
+	// delete a heap frame, arena frames go away when the arena is reset (after they've all been freed)
+	static void Free(ScannerFrame *sf);
 };
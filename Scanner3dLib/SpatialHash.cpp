@@ -0,0 +1,205 @@
+#include "SpatialHash.h"
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+SpatialHash::SpatialHash()
+{
+	m_cellsize = 1;
+	m_inv = 1;
+	m_numbuckets = 0;
+	m_start = 0;
+	m_items = 0;
+}
+
+SpatialHash::~SpatialHash()
+{
+	delete []m_start;
+	delete []m_items;
+}
+
+int SpatialHash::Bucket(int cx,int cy,int cz)
+{
+	unsigned int h = ((unsigned int)cx * 73856093u) ^ ((unsigned int)cy * 19349663u) ^ ((unsigned int)cz * 83492791u);
+	return (int)(h & (m_numbuckets - 1));
+}
+
+// floorf is a library call on older compilers, this is in every inner loop
+static inline int FloorInt(float v)
+{
+	int i = (int)v;
+	return i > v ? i - 1 : i;
+}
+
+void SpatialHash::CellOf(float x,float y,float z,int *cx,int *cy,int *cz)
+{
+	*cx = FloorInt(x * m_inv);
+	*cy = FloorInt(y * m_inv);
+	*cz = FloorInt(z * m_inv);
+}
+
+void SpatialHash::CellOf(ScanPoint *p,int *cx,int *cy,int *cz)
+{
+	CellOf(p->x,p->y,p->z,cx,cy,cz);
+}
+
+void SpatialHash::Build(ScanPoint *pnts,int numpnts,float cellsize)
+{
+	m_cellsize = cellsize > 0 ? cellsize : 1;
+	m_inv = 1.0f / m_cellsize;
+	int numbuckets = 64;
+	while(numbuckets < numpnts * 2)
+		numbuckets *= 2;
+	if(numbuckets != m_numbuckets)
+	{
+		delete []m_start;
+		m_start = new int[numbuckets + 1];
+		m_numbuckets = numbuckets;
+	}
+	delete []m_items;
+	m_items = new Entry[numpnts > 0 ? numpnts : 1];
+
+	//counting sort by bucket, m_start[b + 1] counts first then becomes the offset
+	int *bucket = new int[numpnts > 0 ? numpnts : 1];
+	memset(m_start,0,sizeof(int) * (m_numbuckets + 1));
+	for(int i = 0; i < numpnts; i++)
+	{
+		int cx,cy,cz;
+		CellOf(&pnts[i],&cx,&cy,&cz);
+		bucket[i] = Bucket(cx,cy,cz);
+		m_start[bucket[i] + 1]++;
+	}
+	for(int b = 0; b < m_numbuckets; b++)
+		m_start[b + 1] += m_start[b];
+	int *fill = new int[m_numbuckets];
+	memcpy(fill,m_start,sizeof(int) * m_numbuckets);
+	for(int i = 0; i < numpnts; i++)
+	{
+		Entry *e = &m_items[fill[bucket[i]]++];
+		e->x = pnts[i].x;
+		e->y = pnts[i].y;
+		e->z = pnts[i].z;
+		e->index = i;
+	}
+	delete []fill;
+	delete []bucket;
+}
+
+/*
+A first guess from the bounding box, then one correction from the
+measured occupancy. Scans are surfaces, so the points per cell go
+with the square of the cell size.
+*/
+void SpatialHash::BuildAdaptive(ScanPoint *pnts,int numpnts,int percell)
+{
+	float minx = FLT_MAX,miny = FLT_MAX,minz = FLT_MAX;
+	float maxx = -FLT_MAX,maxy = -FLT_MAX,maxz = -FLT_MAX;
+	for(int i = 0; i < numpnts; i++)
+	{
+		if(pnts[i].x < minx) minx = pnts[i].x;
+		if(pnts[i].x > maxx) maxx = pnts[i].x;
+		if(pnts[i].y < miny) miny = pnts[i].y;
+		if(pnts[i].y > maxy) maxy = pnts[i].y;
+		if(pnts[i].z < minz) minz = pnts[i].z;
+		if(pnts[i].z > maxz) maxz = pnts[i].z;
+	}
+	float extent = maxx - minx;
+	if(maxy - miny > extent) extent = maxy - miny;
+	if(maxz - minz > extent) extent = maxz - minz;
+	if(numpnts < 2 || extent <= 0)
+	{
+		Build(pnts,numpnts,1);
+		return;
+	}
+	float cell = extent / sqrtf((float)numpnts / (percell > 0 ? percell : 1));
+	Build(pnts,numpnts,cell);
+	int occupied = 0;
+	for(int b = 0; b < m_numbuckets; b++)
+		if(m_start[b + 1] > m_start[b])
+			occupied++;
+	float ratio = sqrtf((float)percell * occupied / numpnts);
+	if(ratio < 0.25f) ratio = 0.25f;
+	if(ratio > 4.0f) ratio = 4.0f;
+	if(ratio < 0.8f || ratio > 1.25f)
+		Build(pnts,numpnts,cell * ratio);
+}
+
+int SpatialHash::CountWithin(float x,float y,float z,float radius,int max)
+{
+	int cx,cy,cz;
+	CellOf(x,y,z,&cx,&cy,&cz);
+	int r = (int)ceilf(radius * m_inv);
+	float r2 = radius * radius;
+	int count = 0;
+	for(int dz = -r; dz <= r; dz++)
+	for(int dy = -r; dy <= r; dy++)
+	for(int dx = -r; dx <= r; dx++)
+	{
+		int b = Bucket(cx + dx,cy + dy,cz + dz);
+		for(int i = m_start[b]; i < m_start[b + 1]; i++)
+		{
+			Entry *p = &m_items[i];
+			int px,py,pz;
+			CellOf(p->x,p->y,p->z,&px,&py,&pz);
+			if(px != cx + dx || py != cy + dy || pz != cz + dz)
+				continue; // another cell in the same bucket
+			float ddx = p->x - x,ddy = p->y - y,ddz = p->z - z;
+			if(ddx * ddx + ddy * ddy + ddz * ddz <= r2)
+			{
+				if(++count >= max)
+					return count;
+			}
+		}
+	}
+	return count;
+}
+
+/*
+Searches outwards one shell of cells at a time, once there are k points and
+the k'th is closer than anything in the next shell could be, it's done.
+*/
+int SpatialHash::Nearest(float x,float y,float z,int k,int skip,int *idx,float *dist2,int maxring)
+{
+	int cx,cy,cz;
+	CellOf(x,y,z,&cx,&cy,&cz);
+	int found = 0;
+	for(int r = 0; r <= maxring; r++)
+	{
+		for(int dz = -r; dz <= r; dz++)
+		for(int dy = -r; dy <= r; dy++)
+		for(int dx = -r; dx <= r; dx++)
+		{
+			if(dx != -r && dx != r && dy != -r && dy != r && dz != -r && dz != r)
+				continue; // inside the shell, already done
+			int b = Bucket(cx + dx,cy + dy,cz + dz);
+			for(int i = m_start[b]; i < m_start[b + 1]; i++)
+			{
+				Entry *p = &m_items[i];
+				if(p->index == skip)
+					continue;
+				int px,py,pz;
+				CellOf(p->x,p->y,p->z,&px,&py,&pz);
+				if(px != cx + dx || py != cy + dy || pz != cz + dz)
+					continue;
+				float ddx = p->x - x,ddy = p->y - y,ddz = p->z - z;
+				float d2 = ddx * ddx + ddy * ddy + ddz * ddz;
+				if(found == k && d2 >= dist2[k - 1])
+					continue;
+				//insertion into the sorted list
+				int j = found < k ? found++ : k - 1;
+				while(j > 0 && dist2[j - 1] > d2)
+				{
+					dist2[j] = dist2[j - 1];
+					idx[j] = idx[j - 1];
+					j--;
+				}
+				dist2[j] = d2;
+				idx[j] = p->index;
+			}
+		}
+		float reach = r * m_cellsize;
+		if(found == k && dist2[k - 1] <= reach * reach)
+			break;
+	}
+	return found;
+}
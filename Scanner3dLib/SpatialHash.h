@@ -0,0 +1,59 @@
+#pragma once
+#include "ScanPoint.h"
+/*
+A uniform grid over a contiguous point array, for neighbour searches.
+Only the occupied cells cost anything: the cell coordinates are hashed into
+a bucket table twice the size of the point count and the point indices are
+counting-sorted by bucket, so building is O(n) with 2 flat arrays and no
+per-cell allocation. The positions are copied next to the indices in bucket
+order, so a query reads each cell's points from one contiguous run instead
+of jumping around the point array. Different cells can share a bucket, the
+queries check the cell of every point they look at so nothing is counted twice.
+
+Running the queries in bucket order (Item(0) .. Item(n - 1)) keeps
+neighbouring queries on the same cells, which is much kinder to the cache
+than going through the points in scan order.
+
+The points must not move or be reordered while the hash is in use.
+Queries only read, so they can run from several threads at once.
+*/
+class SpatialHash
+{
+public:
+	SpatialHash();
+	~SpatialHash();
+	void Build(ScanPoint *pnts,int numpnts,float cellsize);
+	// picks a cell size that puts about percell points in each occupied cell, then builds
+	void BuildAdaptive(ScanPoint *pnts,int numpnts,int percell);
+	float CellSize(){return m_cellsize;}
+
+	// number of points within radius of (x,y,z), stops counting at max
+	int CountWithin(float x,float y,float z,float radius,int max);
+	/*
+	the k nearest points to (x,y,z), nearest first, skipping the point index skip (-1 for none)
+	idx and dist2 need room for k, returns how many were found (< k if the search ran out)
+	only searches up to maxring cells away
+	*/
+	int Nearest(float x,float y,float z,int k,int skip,int *idx,float *dist2,int maxring = 4);
+
+	// the points are grouped by bucket, BucketStart/BucketEnd/Item walk them for callers that work per cell
+	int NumBuckets(){return m_numbuckets;}
+	int BucketStart(int bucket){return m_start[bucket];}
+	int BucketEnd(int bucket){return m_start[bucket + 1];}
+	int Item(int i){return m_items[i].index;}
+	void CellOf(ScanPoint *p,int *cx,int *cy,int *cz);
+private:
+	float m_cellsize;
+	float m_inv; // 1 / m_cellsize
+	int m_numbuckets; // power of 2
+	int *m_start; // m_numbuckets + 1 offsets into m_items
+	struct Entry
+	{
+		float x,y,z;
+		int index; // into the point array
+	};
+	Entry *m_items; // sorted by bucket
+
+	int Bucket(int cx,int cy,int cz);
+	void CellOf(float x,float y,float z,int *cx,int *cy,int *cz);
+};
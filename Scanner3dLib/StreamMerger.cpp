@@ -0,0 +1,224 @@
+#include "StreamMerger.h"
+#include <string.h>
+#include <windows.h>
+
+#define MAX_SPILL_FILES 256 // open at once, the CRT stops at 512 streams
+
+StreamMerger::StreamMerger()
+{
+	m_budget = 256 * 1024 * 1024;
+	m_numtiles = 0;
+	m_out = 0;
+	m_countpos = 0;
+	m_written = 0;
+}
+
+/*
+Binary PLY, the vertex count isn't known until the end so a fixed width
+placeholder is written and filled in by EndPLY
+*/
+bool StreamMerger::BeginPLY(char *plyfile)
+{
+	m_out = fopen(plyfile,"wb");
+	if(m_out == 0)
+		return false;
+	m_written = 0;
+	fprintf(m_out,"ply\n");
+	fprintf(m_out,"format binary_little_endian 1.0\n");
+	fprintf(m_out,"element vertex ");
+	m_countpos = ftell(m_out);
+	fprintf(m_out,"%010d\n",0);
+	fprintf(m_out,"property float x\n");
+	fprintf(m_out,"property float y\n");
+	fprintf(m_out,"property float z\n");
+	fprintf(m_out,"property uchar diffuse_red\n");
+	fprintf(m_out,"property uchar diffuse_green\n");
+	fprintf(m_out,"property uchar diffuse_blue\n");
+	fprintf(m_out,"end_header\n");
+	return true;
+}
+
+void StreamMerger::EndPLY()
+{
+	fseek(m_out,m_countpos,SEEK_SET);
+	fprintf(m_out,"%010d",m_written);
+	fclose(m_out);
+	m_out = 0;
+}
+
+// add the points to the grid of rows firstrow .. firstrow + numrows - 1
+void StreamMerger::Accumulate(PixelSum *grid,int width,int firstrow,int numrows,ScanPoint *pnts,int numpnts)
+{
+	for(int c = 0; c < numpnts; c++)
+	{
+		int px = pnts[c].PixelX(),py = pnts[c].PixelY() - firstrow;
+		if(px >= width || py < 0 || py >= numrows)
+			continue;
+		grid[py * width + px].Add(pnts[c].x,pnts[c].y,pnts[c].z,pnts[c].weight,pnts[c].rgb);
+	}
+}
+
+// write out the fused point of every pixel that has points
+void StreamMerger::Emit(PixelSum *grid,int numcells)
+{
+	unsigned char buf[15 * 1024];
+	int inbuf = 0;
+	for(int c = 0; c < numcells; c++)
+	{
+		PixelSum *ps = &grid[c];
+		if(ps->count == 0)
+			continue;
+		float xyz[3];
+		xyz[0] = (float)ps->x;
+		xyz[1] = (float)ps->y;
+		xyz[2] = (float)ps->z;
+		unsigned char *dst = &buf[inbuf * 15];
+		memcpy(dst,xyz,sizeof(xyz));
+		dst[12] = (unsigned char)(ps->rgb >> 16);
+		dst[13] = (unsigned char)(ps->rgb >> 8);
+		dst[14] = (unsigned char)ps->rgb;
+		if(++inbuf == 1024)
+		{
+			fwrite(buf,15,inbuf,m_out);
+			inbuf = 0;
+		}
+		m_written++;
+	}
+	if(inbuf > 0)
+		fwrite(buf,15,inbuf,m_out);
+}
+
+int StreamMerger::Merge(ScanSpool *in,char *plyfile)
+{
+	int width = in->Width(),height = in->Height();
+	if(!in->IsOpen() || width <= 0 || height <= 0 || !in->Rewind())
+		return -1;
+	//an eighth of the budget for reading, the rest for the grid and the spill buffers
+	size_t rowbytes = sizeof(PixelSum) * width;
+	int chunk = (int)(m_budget / 8 / sizeof(ScanPoint));
+	if(chunk > 65536)
+		chunk = 65536;
+	if(chunk < 1024)
+		chunk = 1024;
+	size_t gridbudget = m_budget - m_budget / 8;
+	int tilerows = (int)(gridbudget / rowbytes);
+	if(tilerows >= height)
+		tilerows = height;
+	m_numtiles = 1;
+	if(tilerows < height)
+	{
+		//leave a quarter of the grid budget for the spill buffers
+		tilerows = (int)(gridbudget * 3 / 4 / rowbytes);
+		if(tilerows < 1)
+			tilerows = 1;
+		m_numtiles = (height + tilerows - 1) / tilerows;
+	}
+	if(!BeginPLY(plyfile))
+		return -1;
+	ScanPoint *pnts = new ScanPoint[chunk];
+	PixelSum *grid = new PixelSum[tilerows * width];
+	int num;
+
+	if(m_numtiles == 1)
+	{
+		//everything fits, one pass straight from the spool
+		memset(grid,0,rowbytes * tilerows);
+		while((num = in->Read(pnts,chunk)) > 0)
+			Accumulate(grid,width,0,tilerows,pnts,num);
+		Emit(grid,tilerows * width);
+	}
+	else
+	{
+		//only so many spill files can be open at once, past that the tiles are done
+		//in rounds, each round reads the spool again for its own tiles
+		int numround = m_numtiles < MAX_SPILL_FILES ? m_numtiles : MAX_SPILL_FILES;
+		FILE **spill = new FILE *[numround];
+		char (*spillname)[MAX_PATH] = new char[numround][MAX_PATH];
+		char tmpdir[MAX_PATH];
+		if(GetTempPathA(MAX_PATH,tmpdir) == 0)
+			strcpy(tmpdir,".");
+		int spillsize = (int)(gridbudget / 4 / numround / sizeof(ScanPoint));
+		if(spillsize < 256)
+			spillsize = 256;
+		ScanPoint *spillbuf = new ScanPoint[numround * spillsize];
+		int *spillcount = new int[numround];
+		bool ok = true;
+		for(int first = 0; ok && first < m_numtiles; first += numround)
+		{
+			int count = m_numtiles - first < numround ? m_numtiles - first : numround;
+			if(first > 0 && !in->Rewind())
+				ok = false;
+			//pass 1, sort the points into a spill file per tile
+			for(int t = 0; t < count; t++)
+			{
+				//the files are removed after pass 2, tmpfile() wants the root of C: on Windows
+				spill[t] = 0;
+				spillcount[t] = 0;
+				if(GetTempFileNameA(tmpdir,"mss",0,spillname[t]) == 0)
+				{
+					spillname[t][0] = 0;
+					ok = false;
+					continue;
+				}
+				spill[t] = fopen(spillname[t],"w+b");
+				if(spill[t] == 0)
+					ok = false;
+			}
+			while(ok && (num = in->Read(pnts,chunk)) > 0)
+			{
+				for(int c = 0; c < num; c++)
+				{
+					int t = pnts[c].PixelY() / tilerows - first;
+					if(t < 0 || t >= count || pnts[c].PixelX() >= width)
+						continue;
+					spillbuf[t * spillsize + spillcount[t]++] = pnts[c];
+					if(spillcount[t] == spillsize)
+					{
+						if(fwrite(&spillbuf[t * spillsize],sizeof(ScanPoint),spillsize,spill[t]) != (size_t)spillsize)
+							ok = false;
+						spillcount[t] = 0;
+					}
+				}
+			}
+			//pass 2, merge each tile on its own
+			for(int t = 0; t < count; t++)
+			{
+				if(spill[t] == 0)
+				{
+					if(spillname[t][0] != 0)
+						remove(spillname[t]); // GetTempFileName made it empty
+					continue;
+				}
+				if(ok)
+				{
+					if(spillcount[t] > 0)
+						fwrite(&spillbuf[t * spillsize],sizeof(ScanPoint),spillcount[t],spill[t]);
+					int firstrow = (first + t) * tilerows;
+					int numrows = height - firstrow < tilerows ? height - firstrow : tilerows;
+					memset(grid,0,rowbytes * numrows);
+					rewind(spill[t]);
+					while((num = (int)fread(pnts,sizeof(ScanPoint),chunk,spill[t])) > 0)
+						Accumulate(grid,width,firstrow,numrows,pnts,num);
+					Emit(grid,numrows * width);
+				}
+				fclose(spill[t]);
+				remove(spillname[t]);
+			}
+		}
+		delete []spillname;
+		delete []spillcount;
+		delete []spillbuf;
+		delete []spill;
+		if(!ok)
+		{
+			delete []grid;
+			delete []pnts;
+			EndPLY();
+			return -1;
+		}
+	}
+	delete []grid;
+	delete []pnts;
+	EndPLY();
+	return m_written;
+}
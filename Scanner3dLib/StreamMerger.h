@@ -0,0 +1,41 @@
+#pragma once
+#include <stdio.h>
+#include "ScanSpool.h"
+#include "LiveMerge.h"
+/*
+The per pixel merge of PostProcessor::MergePoints, done out of core so the
+session can be bigger than memory. The points are read from a ScanSpool a
+chunk at a time and each pixel's sum is kept in a grid, so memory goes with
+the image size, not the number of points.
+
+When even the grid doesn't fit in m_budget, the image is cut into bands of
+rows (tiles). A first pass sorts the points into one temporary spill file
+per tile, then each tile is merged on its own with a grid just the size
+of the tile. With more tiles than files can be open at once the spool is
+read again for each group of tiles. Either way the merged points are written to a binary PLY
+as they're made, in a single pass over each tile.
+
+The result is the same as MergePoints, each pixel is fused the same way
+as in the LiveMerge.
+*/
+class StreamMerger
+{
+public:
+	size_t m_budget; // bytes of memory the merge may use
+
+	StreamMerger();
+	// returns the number of merged points written, -1 on error
+	int Merge(ScanSpool *in,char *plyfile);
+	int NumTiles(){return m_numtiles;}
+private:
+	typedef LiveMerge::PixelSum PixelSum;
+	int m_numtiles;
+	FILE *m_out;
+	long m_countpos; // where the vertex count goes in the PLY header
+	int m_written;
+
+	bool BeginPLY(char *plyfile);
+	void EndPLY();
+	void Accumulate(PixelSum *grid,int width,int firstrow,int numrows,ScanPoint *pnts,int numpnts);
+	void Emit(PixelSum *grid,int numcells);
+};
@@ -852,8 +852,9 @@ int runProjectorCalibration(CvCapture* capture,
 	sl_calib->proj_intrinsic_calib   = true;
 	sl_calib->procam_extrinsic_calib = true;
 
-	// Evaluate projector-camera geometry.
+	// Evaluate projector-camera geometry (and update the binary cache).
 	evaluateProCamGeometry(sl_params, sl_calib);
+	saveProCamGeometryCache(sl_params, sl_calib);
 
 	// Free allocated resources.
 	cvReleaseMat(&cam_image_points);
@@ -1184,8 +1185,9 @@ int runProCamExtrinsicCalibration(CvCapture* capture,
 	// Set projector-camera calibration status.
 	sl_calib->procam_extrinsic_calib = true;
 
-	// Evaluate projector-camera geometry.
+	// Evaluate projector-camera geometry (and update the binary cache).
 	evaluateProCamGeometry(sl_params, sl_calib);
+	saveProCamGeometryCache(sl_params, sl_calib);
 
 	// Free allocated resources.
 	cvReleaseMat(&cam_image_points);
@@ -1343,4 +1345,179 @@ int evaluateProCamGeometry(struct slParams* sl_params, struct slCalib* sl_calib)
 
 	// Return without errors.
 	return 0;
-}
\ No newline at end of file
+}
+// Define header for the binary projector-camera geometry cache.
+// Note: The header is followed by the cam_center, proj_center, cam_rays, proj_rays, 
+//       proj_column_planes, and proj_row_planes tables (in that order) as raw floats.
+#define SL_GEOMETRY_CACHE_VERSION 1
+struct slGeometryCacheHeader{
+	char         magic[4];              // file identifier ("SLGC")
+	int          version;               // cache layout version
+	unsigned int key;                   // hash of calibration parameters and resolutions
+	int          cam_w, cam_h;          // camera resolution
+	int          proj_w, proj_h;        // projector resolution
+	int          reserved;              // padding (keeps table data 16-byte aligned)
+};
+
+// Accumulate the contents of a calibration matrix into an FNV-1a hash.
+static unsigned int hashMat(unsigned int hash, const CvMat* mat){
+	for(int r=0; r<mat->rows; r++){
+		const uchar* data = mat->data.ptr + r*mat->step;
+		for(int i=0; i<mat->cols*CV_ELEM_SIZE(mat->type); i++){
+			hash ^= data[i];
+			hash *= 16777619u;
+		}
+	}
+	return hash;
+}
+
+// Evaluate the key used to index the projector-camera geometry cache.
+static unsigned int geometryCacheKey(struct slParams* sl_params, struct slCalib* sl_calib){
+	int dims[5] = {SL_GEOMETRY_CACHE_VERSION, sl_params->cam_w, sl_params->cam_h, sl_params->proj_w, sl_params->proj_h};
+	unsigned int hash = 2166136261u;
+	for(int i=0; i<(int)sizeof(dims); i++){
+		hash ^= ((uchar*)dims)[i];
+		hash *= 16777619u;
+	}
+	hash = hashMat(hash, sl_calib->cam_intrinsic);
+	hash = hashMat(hash, sl_calib->cam_distortion);
+	hash = hashMat(hash, sl_calib->cam_extrinsic);
+	hash = hashMat(hash, sl_calib->proj_intrinsic);
+	hash = hashMat(hash, sl_calib->proj_distortion);
+	hash = hashMat(hash, sl_calib->proj_extrinsic);
+	return hash;
+}
+
+// Save the projector-camera geometry (i.e., optical rays and planes) to a binary cache file.
+int saveProCamGeometryCache(struct slParams* sl_params, struct slCalib* sl_calib){
+
+	// Check for input errors (geometry must be evaluated first).
+	if(!sl_calib->cam_intrinsic_calib || !sl_calib->proj_intrinsic_calib || !sl_calib->procam_extrinsic_calib)
+		return -1;
+
+	// Create cache file (named by the calibration key, so stale caches are never reused).
+	char str[1024];
+	struct slGeometryCacheHeader header;
+	memcpy(header.magic, "SLGC", 4);
+	header.version  = SL_GEOMETRY_CACHE_VERSION;
+	header.key      = geometryCacheKey(sl_params, sl_calib);
+	header.cam_w    = sl_params->cam_w;
+	header.cam_h    = sl_params->cam_h;
+	header.proj_w   = sl_params->proj_w;
+	header.proj_h   = sl_params->proj_h;
+	header.reserved = 0;
+	sprintf(str, "%s\\calib\\proj\\procam_geometry_%08x.bin", sl_params->outdir, header.key);
+	FILE* pFile = fopen(str, "wb");
+	if(pFile == NULL){
+		printf("ERROR: Cannot open projector-camera geometry cache \"%s\"!\n", str);
+		return -1;
+	}
+
+	// Write header and geometry tables.
+	int cam_nelems  = sl_params->cam_w*sl_params->cam_h;
+	int proj_nelems = sl_params->proj_w*sl_params->proj_h;
+	fwrite(&header, sizeof(header), 1, pFile);
+	fwrite(sl_calib->cam_center->data.fl,         sizeof(float), 3,                    pFile);
+	fwrite(sl_calib->proj_center->data.fl,        sizeof(float), 3,                    pFile);
+	fwrite(sl_calib->cam_rays->data.fl,           sizeof(float), 3*cam_nelems,         pFile);
+	fwrite(sl_calib->proj_rays->data.fl,          sizeof(float), 3*proj_nelems,        pFile);
+	fwrite(sl_calib->proj_column_planes->data.fl, sizeof(float), 4*sl_params->proj_w, pFile);
+	fwrite(sl_calib->proj_row_planes->data.fl,    sizeof(float), 4*sl_params->proj_h, pFile);
+	if(fclose(pFile) != 0){
+		printf("ERROR: Cannot close projector-camera geometry cache!\n");
+		return -1;
+	}
+
+	// Return without errors.
+	return 0;
+}
+
+// Map the projector-camera geometry directly from a binary cache file (if one exists).
+// Note: The file is mapped copy-on-write, so several processes share the same physical
+//       pages and any later re-evaluation of the geometry only touches private copies.
+//       Returns 0 if the cache was mapped, -1 if it must be evaluated instead.
+int loadProCamGeometryCache(struct slParams* sl_params, struct slCalib* sl_calib){
+
+	// Open cache file corresponding to the current calibration.
+	char str[1024];
+	unsigned int key = geometryCacheKey(sl_params, sl_calib);
+	sprintf(str, "%s\\calib\\proj\\procam_geometry_%08x.bin", sl_params->outdir, key);
+	HANDLE file = CreateFileA(str, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return -1;
+
+	// Verify file size before mapping.
+	int cam_nelems  = sl_params->cam_w*sl_params->cam_h;
+	int proj_nelems = sl_params->proj_w*sl_params->proj_h;
+	int n_floats    = 3 + 3 + 3*cam_nelems + 3*proj_nelems + 4*sl_params->proj_w + 4*sl_params->proj_h;
+	DWORD file_size = GetFileSize(file, NULL);
+	if(file_size != sizeof(struct slGeometryCacheHeader) + n_floats*sizeof(float)){
+		CloseHandle(file);
+		return -1;
+	}
+
+	// Map the cache file.
+	// Note: The view keeps the mapping alive, so both handles can be closed immediately.
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle(file);
+	if(mapping == NULL)
+		return -1;
+	void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping);
+	if(view == NULL)
+		return -1;
+
+	// Validate the header.
+	struct slGeometryCacheHeader* header = (struct slGeometryCacheHeader*)view;
+	if(memcmp(header->magic, "SLGC", 4) != 0 || header->version != SL_GEOMETRY_CACHE_VERSION || header->key != key ||
+	   header->cam_w  != sl_params->cam_w  || header->cam_h  != sl_params->cam_h ||
+	   header->proj_w != sl_params->proj_w || header->proj_h != sl_params->proj_h){
+		UnmapViewOfFile(view);
+		return -1;
+	}
+
+	// Replace the geometry tables with headers pointing into the mapped view.
+	void* previous_view = sl_calib->geometry_cache;
+	cvReleaseMat(&sl_calib->cam_center);
+	cvReleaseMat(&sl_calib->proj_center);
+	cvReleaseMat(&sl_calib->cam_rays);
+	cvReleaseMat(&sl_calib->proj_rays);
+	cvReleaseMat(&sl_calib->proj_column_planes);
+	cvReleaseMat(&sl_calib->proj_row_planes);
+	float* data = (float*)(header+1);
+	sl_calib->cam_center         = cvCreateMatHeader(3, 1, CV_32FC1);
+	sl_calib->proj_center        = cvCreateMatHeader(3, 1, CV_32FC1);
+	sl_calib->cam_rays           = cvCreateMatHeader(3, cam_nelems, CV_32FC1);
+	sl_calib->proj_rays          = cvCreateMatHeader(3, proj_nelems, CV_32FC1);
+	sl_calib->proj_column_planes = cvCreateMatHeader(sl_params->proj_w, 4, CV_32FC1);
+	sl_calib->proj_row_planes    = cvCreateMatHeader(sl_params->proj_h, 4, CV_32FC1);
+	cvSetData(sl_calib->cam_center,         data, CV_AUTOSTEP); data += 3;
+	cvSetData(sl_calib->proj_center,        data, CV_AUTOSTEP); data += 3;
+	cvSetData(sl_calib->cam_rays,           data, CV_AUTOSTEP); data += 3*cam_nelems;
+	cvSetData(sl_calib->proj_rays,          data, CV_AUTOSTEP); data += 3*proj_nelems;
+	cvSetData(sl_calib->proj_column_planes, data, CV_AUTOSTEP); data += 4*sl_params->proj_w;
+	cvSetData(sl_calib->proj_row_planes,    data, CV_AUTOSTEP);
+	sl_calib->geometry_cache = view;
+	if(previous_view != NULL)
+		UnmapViewOfFile(previous_view);
+
+	// Return without errors.
+	return 0;
+}
+
+// Release the mapped projector-camera geometry cache (if any).
+// Note: Geometry tables are copied to the heap first, so they remain valid afterwards.
+void releaseProCamGeometryCache(struct slCalib* sl_calib){
+	if(sl_calib->geometry_cache == NULL)
+		return;
+	CvMat** tables[6] = {&sl_calib->cam_center, &sl_calib->proj_center, 
+		                 &sl_calib->cam_rays,   &sl_calib->proj_rays, 
+						 &sl_calib->proj_column_planes, &sl_calib->proj_row_planes};
+	for(int i=0; i<6; i++){
+		CvMat* table = cvCloneMat(*tables[i]);
+		cvReleaseMat(tables[i]);
+		*tables[i] = table;
+	}
+	UnmapViewOfFile(sl_calib->geometry_cache);
+	sl_calib->geometry_cache = NULL;
+}
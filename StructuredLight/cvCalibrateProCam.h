@@ -49,4 +49,14 @@ int runProjectorCalibration(CvCapture* capture, struct slParams* sl_params, stru
 int runProCamExtrinsicCalibration(CvCapture* capture, struct slParams* sl_params, struct slCalib* sl_calib);
 
 // Evaluate geometry of projector-camera optical rays and planes.
-int evaluateProCamGeometry(struct slParams* sl_params, struct slCalib* sl_calib);
\ No newline at end of file
+int evaluateProCamGeometry(struct slParams* sl_params, struct slCalib* sl_calib);
+
+// Save the projector-camera geometry (i.e., optical rays and planes) to a binary cache file.
+int saveProCamGeometryCache(struct slParams* sl_params, struct slCalib* sl_calib);
+
+// Map the projector-camera geometry directly from a binary cache file (if one exists).
+// Note: Returns 0 if the cache was mapped, -1 if the geometry must be evaluated instead.
+int loadProCamGeometryCache(struct slParams* sl_params, struct slCalib* sl_calib);
+
+// Release the mapped projector-camera geometry cache (if any).
+void releaseProCamGeometryCache(struct slCalib* sl_calib);
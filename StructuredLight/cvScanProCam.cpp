@@ -11,6 +11,9 @@
 //   camera is intersected with the corresponding projector column and/or row. In the later,
 //   the corresponding optical rays from the camera and projector are intersected; in this 
 //   case, the 3D point is assigned as the closest point to the two (generally skewed) rays.
+//   Two pattern families are implemented, including: (1) binary Gray codes and (2) phase-
+//   shifted sinusoids, unwrapped using coarse Gray codes, which provide sub-projector-pixel 
+//   correspondences from fewer images.
 //   
 // Details:
 //   Please read the SIGGRAPH 2009 course notes for additional details.
@@ -26,6 +29,7 @@
 
 #include "stdafx.h"
 #include <direct.h>
+#include <emmintrin.h>
 #include "cvStructuredLight.h"
 #include "cvScanProCam.h"
 #include "cvUtilProCam.h"
@@ -65,30 +69,25 @@ int generateGrayCodes(int width, int height,
 	cvSet(gray_codes[0], cvScalar(255));
 
 	// Define Gray codes for projector columns.
-	for(int c=0; c<width; c++){
-		for(int i=0; i<n_cols; i++){
-			uchar* data = (uchar*)gray_codes[i+1]->imageData;
-			if(i>0)
-				data[c] = (((c+col_shift) >> (n_cols-i-1)) & 1)^(((c+col_shift) >> (n_cols-i)) & 1);
-			else
-				data[c] = (((c+col_shift) >> (n_cols-i-1)) & 1);
-			data[c] *= 255;
-			for(int r=1; r<height; r++)
-				data[r*step+c] = data[c];	
+	// Note: Column codes are constant down each column, so a single stripe is evaluated
+	//       and then broadcast to every row of the image.
+	uchar* stripe = new uchar[width];
+	for(int i=0; i<n_cols; i++){
+		for(int c=0; c<width; c++){
+			int code = (c+col_shift) ^ ((c+col_shift) >> 1);
+			stripe[c] = (uchar)(255*((code >> (n_cols-i-1)) & 1));
 		}
+		for(int r=0; r<height; r++)
+			memcpy(gray_codes[i+1]->imageData + r*step, stripe, width);
 	}
+	delete[] stripe;
 
 	// Define Gray codes for projector rows.
-	for(int r=0; r<height; r++){
-		for(int i=0; i<n_rows; i++){
-			uchar* data = (uchar*)gray_codes[i+n_cols+1]->imageData;
-			if(i>0)
-				data[r*step] = (((r+row_shift) >> (n_rows-i-1)) & 1)^(((r+row_shift) >> (n_rows-i)) & 1);
-			else
-				data[r*step] = (((r+row_shift) >> (n_rows-i-1)) & 1);
-			data[r*step] *= 255;
-			for(int c=1; c<width; c++)
-				data[r*step+c] = data[r*step];	
+	// Note: Row codes are constant along each row, so every row is a single filled span.
+	for(int i=0; i<n_rows; i++){
+		for(int r=0; r<height; r++){
+			int code = (r+row_shift) ^ ((r+row_shift) >> 1);
+			memset(gray_codes[i+n_cols+1]->imageData + r*step, 255*((code >> (n_rows-i-1)) & 1), width);
 		}
 	}
 
@@ -96,74 +95,254 @@ int generateGrayCodes(int width, int height,
 	return 0;
 }
 
-// Decode Gray codes.
-int decodeGrayCodes(int proj_width, int proj_height,
-					IplImage**& gray_codes, 
-					IplImage*& decoded_cols,
-					IplImage*& decoded_rows,
-					IplImage*& mask,
-					int& n_cols, int& n_rows,
-					int& col_shift, int& row_shift, 
-					int sl_thresh){
+// Generate phase-shifted sinusoids (with coarse Gray codes for phase unwrapping).
+// Note: For each scanned axis, the codes consist of a coarse Gray code (with a resolution of half
+//       the sinusoid period) followed by phase_steps/2 sinusoids. Since the inverse of a sinusoid 
+//       is the same sinusoid shifted by pi, the inverse patterns (displayed by slScan) supply the 
+//       remaining phase shifts. The returned n_cols/n_rows include the Gray codes and sinusoids.
+int generatePhaseShiftCodes(int width, int height, 
+							IplImage**& codes, 
+							int& n_cols, int& n_rows,
+							int& col_shift, int& row_shift, 
+							bool sl_scan_cols, bool sl_scan_rows,
+							int phase_steps, int phase_period){
 
-	// Extract width and height of images.
-	int cam_width  = gray_codes[0]->width;
-	int cam_height = gray_codes[0]->height;
+	// Determine number of required codes and row/column offsets.
+	int n_phase     = phase_steps/2;
+	int period_bits = (int)floor(log2(phase_period)+0.5);
+	int n_gray_cols = 0, n_gray_rows = 0;
+	if(sl_scan_cols){
+		int n_bits  = (int)ceil(log2(width));
+		n_gray_cols = n_bits-period_bits+1;
+		n_cols      = n_gray_cols+n_phase;
+		col_shift   = (int)floor((pow(2.0,n_bits)-width)/2);
+	}
+	else{
+		n_cols = 0;
+		col_shift = 0;
+	}
+	if(sl_scan_rows){
+		int n_bits  = (int)ceil(log2(height));
+		n_gray_rows = n_bits-period_bits+1;
+		n_rows      = n_gray_rows+n_phase;
+		row_shift   = (int)floor((pow(2.0,n_bits)-height)/2);
+	}
+	else{
+		n_rows = 0;
+		row_shift = 0;
+	}
 
-	// Allocate temporary variables.
-	IplImage* gray_1      = cvCreateImage(cvSize(cam_width, cam_height), IPL_DEPTH_8U,  1);
-	IplImage* gray_2      = cvCreateImage(cvSize(cam_width, cam_height), IPL_DEPTH_8U,  1);
-	IplImage* bit_plane_1 = cvCreateImage(cvSize(cam_width, cam_height), IPL_DEPTH_8U,  1);
-	IplImage* bit_plane_2 = cvCreateImage(cvSize(cam_width, cam_height), IPL_DEPTH_8U,  1);
-	IplImage* temp        = cvCreateImage(cvSize(cam_width, cam_height), IPL_DEPTH_8U,  1);
+	// Allocate codes.
+	codes = new IplImage* [n_cols+n_rows+1];
+	for(int i=0; i<(n_cols+n_rows+1); i++)
+		codes[i] = cvCreateImage(cvSize(width,height), IPL_DEPTH_8U, 1);
+	int step = codes[0]->widthStep/sizeof(uchar);
 
-	// Initialize image mask (indicates reconstructed pixels).
-	cvSet(mask, cvScalar(0));
+	// Define first code as a white image.
+	cvSet(codes[0], cvScalar(255));
 
-	// Decode Gray codes for projector columns.
-	cvZero(decoded_cols);
+	// Define coarse Gray codes and sinusoids for projector columns.
+	// Note: As for the Gray codes, a single stripe is evaluated and broadcast to every row.
+	uchar* stripe = new uchar[width];
 	for(int i=0; i<n_cols; i++){
+		for(int c=0; c<width; c++){
+			int x = c+col_shift;
+			if(i < n_gray_cols){
+				int code = (x >> (period_bits-1)) ^ (x >> period_bits);
+				stripe[c] = (uchar)(255*((code >> (n_gray_cols-i-1)) & 1));
+			}
+			else{
+				double theta = 2*CV_PI*(x % phase_period)/phase_period - CV_PI*(i-n_gray_cols)/n_phase;
+				stripe[c] = (uchar)floor(127.5*(1+cos(theta))+0.5);
+			}
+		}
+		for(int r=0; r<height; r++)
+			memcpy(codes[i+1]->imageData + r*step, stripe, width);
+	}
+	delete[] stripe;
 
-		// Decode bit-plane and update mask.
-		cvCvtColor(gray_codes[2*(i+1)],   gray_1, CV_RGB2GRAY);
-		cvCvtColor(gray_codes[2*(i+1)+1], gray_2, CV_RGB2GRAY);
-		cvAbsDiff(gray_1, gray_2, temp);
-		cvCmpS(temp, sl_thresh, temp, CV_CMP_GE);
-		cvOr(temp, mask, mask);
-		cvCmp(gray_1, gray_2, bit_plane_2, CV_CMP_GE);
+	// Define coarse Gray codes and sinusoids for projector rows.
+	for(int i=0; i<n_rows; i++){
+		for(int r=0; r<height; r++){
+			int y = r+row_shift;
+			int value;
+			if(i < n_gray_rows){
+				int code = (y >> (period_bits-1)) ^ (y >> period_bits);
+				value = 255*((code >> (n_gray_rows-i-1)) & 1);
+			}
+			else{
+				double theta = 2*CV_PI*(y % phase_period)/phase_period - CV_PI*(i-n_gray_rows)/n_phase;
+				value = (int)floor(127.5*(1+cos(theta))+0.5);
+			}
+			memset(codes[i+n_cols+1]->imageData + r*step, value, width);
+		}
+	}
 
-		// Convert from gray code to decimal value.
-		if(i>0)
-			cvXor(bit_plane_1, bit_plane_2, bit_plane_1);
+	// Return without errors.
+	return 0;
+}
+
+// Define a cached bank of Gray codes (and their inverses).
+// Note: The bank is generated once per process and is reused by every scan with the same
+//       projector resolution and row/column scanning options.
+struct slPatternBank{
+	int        width, height;           // projector resolution
+	bool       scan_cols, scan_rows;    // row/column scanning options
+	int        phase_steps;             // number of phase shifts (zero for Gray codes)
+	int        phase_period;            // period of the sinusoids (phase-shifting patterns only)
+	int        n_cols, n_rows;          // number of column/row codes
+	int        col_shift, row_shift;    // column/row code offsets
+	IplImage** codes;                   // Gray codes (the first code is a white image)
+	IplImage** inverse_codes;           // inverse Gray codes (the first is a black image)
+};
+static struct slPatternBank sl_pattern_bank = {0, 0, false, false, 0, 0, 0, 0, 0, 0, NULL, NULL};
+
+// Release the cached Gray code bank.
+void releaseGrayCodeBank(){
+	if(sl_pattern_bank.codes == NULL)
+		return;
+	for(int i=0; i<(sl_pattern_bank.n_cols+sl_pattern_bank.n_rows+1); i++){
+		cvReleaseImage(&sl_pattern_bank.codes[i]);
+		cvReleaseImage(&sl_pattern_bank.inverse_codes[i]);
+	}
+	delete[] sl_pattern_bank.codes;
+	delete[] sl_pattern_bank.inverse_codes;
+	sl_pattern_bank.codes         = NULL;
+	sl_pattern_bank.inverse_codes = NULL;
+}
+
+// Get Gray codes (and their inverses) from the cached bank, generating them if required.
+// Note: The returned images are owned by the bank and must not be released by the caller.
+//       If phase_steps is non-zero, phase-shifted sinusoids (with coarse Gray codes) are used.
+int getGrayCodeBank(int width, int height, 
+					IplImage**& gray_codes, 
+					IplImage**& inverse_gray_codes,
+					int& n_cols, int& n_rows,
+					int& col_shift, int& row_shift, 
+					bool sl_scan_cols, bool sl_scan_rows,
+					int phase_steps, int phase_period){
+
+	// Regenerate the bank if it is missing or does not match the requested options.
+	if(sl_pattern_bank.codes == NULL ||
+	   sl_pattern_bank.width       != width        || sl_pattern_bank.height       != height ||
+	   sl_pattern_bank.scan_cols   != sl_scan_cols || sl_pattern_bank.scan_rows    != sl_scan_rows ||
+	   sl_pattern_bank.phase_steps != phase_steps  || sl_pattern_bank.phase_period != phase_period){
+		releaseGrayCodeBank();
+		if(phase_steps > 0)
+			generatePhaseShiftCodes(width, height, sl_pattern_bank.codes, 
+				sl_pattern_bank.n_cols, sl_pattern_bank.n_rows, 
+				sl_pattern_bank.col_shift, sl_pattern_bank.row_shift, 
+				sl_scan_cols, sl_scan_rows, phase_steps, phase_period);
 		else
-			cvCopyImage(bit_plane_2, bit_plane_1);
-		cvAddS(decoded_cols, cvScalar(pow(2.0,n_cols-i-1)), decoded_cols, bit_plane_1);
+			generateGrayCodes(width, height, sl_pattern_bank.codes, 
+				sl_pattern_bank.n_cols, sl_pattern_bank.n_rows, 
+				sl_pattern_bank.col_shift, sl_pattern_bank.row_shift, 
+				sl_scan_cols, sl_scan_rows);
+		int n_codes = sl_pattern_bank.n_cols+sl_pattern_bank.n_rows+1;
+		sl_pattern_bank.inverse_codes = new IplImage* [n_codes];
+		for(int i=0; i<n_codes; i++){
+			sl_pattern_bank.inverse_codes[i] = cvCreateImage(cvSize(width,height), IPL_DEPTH_8U, 1);
+			cvSubRS(sl_pattern_bank.codes[i], cvScalar(255), sl_pattern_bank.inverse_codes[i]);
+		}
+		sl_pattern_bank.width        = width;
+		sl_pattern_bank.height       = height;
+		sl_pattern_bank.scan_cols    = sl_scan_cols;
+		sl_pattern_bank.scan_rows    = sl_scan_rows;
+		sl_pattern_bank.phase_steps  = phase_steps;
+		sl_pattern_bank.phase_period = phase_period;
 	}
-	cvSubS(decoded_cols, cvScalar(col_shift), decoded_cols);
 
-	// Decode Gray codes for projector rows.
-	cvZero(decoded_rows);
-	for(int i=0; i<n_rows; i++){
+	// Return cached codes.
+	gray_codes         = sl_pattern_bank.codes;
+	inverse_gray_codes = sl_pattern_bank.inverse_codes;
+	n_cols             = sl_pattern_bank.n_cols;
+	n_rows             = sl_pattern_bank.n_rows;
+	col_shift          = sl_pattern_bank.col_shift;
+	row_shift          = sl_pattern_bank.row_shift;
+	return 0;
+}
+
+// Decode a sequence of Gray code bit-planes (each followed by its inverse) into binary values.
+// Note: The mask is updated to include any pixel exceeding the contrast threshold. If a threshold
+//       image is provided, each bit-plane is instead compared to the per-pixel threshold (i.e., the 
+//       inverse is not used) and the confidence mask excludes pixels with any ambiguous bit.
+static void decodeGrayCodeBits(IplImage** gray_codes, int first, int n_bits,
+							   IplImage* decoded, IplImage* mask, int sl_thresh,
+							   IplImage* threshold, IplImage* confidence){
 
-		// Decode bit-plane and update mask.
-		cvCvtColor(gray_codes[2*(i+n_cols+1)],   gray_1, CV_RGB2GRAY);
-		cvCvtColor(gray_codes[2*(i+n_cols+1)+1], gray_2, CV_RGB2GRAY);
-		cvAbsDiff(gray_1, gray_2, temp);
-		cvCmpS(temp, sl_thresh, temp, CV_CMP_GE);
-		cvOr(temp, mask, mask);
-		cvCmp(gray_1, gray_2, bit_plane_2, CV_CMP_GE);
+	// Allocate temporary variables.
+	CvSize size = cvGetSize(decoded);
+	IplImage* gray_1      = cvCreateImage(size, IPL_DEPTH_8U, 1);
+	IplImage* gray_2      = cvCreateImage(size, IPL_DEPTH_8U, 1);
+	IplImage* bit_plane_1 = cvCreateImage(size, IPL_DEPTH_8U, 1);
+	IplImage* bit_plane_2 = cvCreateImage(size, IPL_DEPTH_8U, 1);
+	IplImage* temp        = cvCreateImage(size, IPL_DEPTH_8U, 1);
+
+	// Decode each bit-plane.
+	cvZero(decoded);
+	for(int i=0; i<n_bits; i++){
+
+		// Decode bit-plane and update mask (or confidence, if the per-pixel threshold is used).
+		// Note: The per-pixel threshold is half-way between the code and its inverse, so the
+		//       contrast threshold is halved for comparisons against it.
+		cvCvtColor(gray_codes[2*(i+first)], gray_1, CV_RGB2GRAY);
+		if(threshold != NULL){
+			cvCmp(gray_1, threshold, bit_plane_2, CV_CMP_GE);
+			if(confidence != NULL){
+				cvAbsDiff(gray_1, threshold, temp);
+				cvCmpS(temp, sl_thresh/2.0, temp, CV_CMP_GE);
+				cvAnd(temp, confidence, confidence);
+			}
+		}
+		else{
+			cvCvtColor(gray_codes[2*(i+first)+1], gray_2, CV_RGB2GRAY);
+			cvAbsDiff(gray_1, gray_2, temp);
+			cvCmpS(temp, sl_thresh, temp, CV_CMP_GE);
+			cvOr(temp, mask, mask);
+			cvCmp(gray_1, gray_2, bit_plane_2, CV_CMP_GE);
+		}
 
 		// Convert from gray code to decimal value.
 		if(i>0)
 			cvXor(bit_plane_1, bit_plane_2, bit_plane_1);
 		else
 			cvCopyImage(bit_plane_2, bit_plane_1);
-		cvAddS(decoded_rows, cvScalar(pow(2.0,n_rows-i-1)), decoded_rows, bit_plane_1);
+		cvAddS(decoded, cvScalar(pow(2.0,n_bits-i-1)), decoded, bit_plane_1);
 	}
-	cvSubS(decoded_rows, cvScalar(row_shift), decoded_rows);
 
-	// Eliminate invalid column/row estimates.
-    // Note: This will exclude pixels if either the column or row is missing or erroneous.
+	// Free allocated resources.
+	cvReleaseImage(&gray_1);
+	cvReleaseImage(&gray_2);
+	cvReleaseImage(&bit_plane_1);
+	cvReleaseImage(&bit_plane_2);
+	cvReleaseImage(&temp);
+}
+
+// Evaluate the per-pixel threshold for single-pattern decoding.
+// Note: The threshold is the midpoint of the white and black images (i.e., the first code and 
+//       its inverse), and the mask includes pixels where their difference exceeds the contrast
+//       threshold. The confidence mask is initialized to the mask.
+static IplImage* createDecodingThreshold(IplImage** gray_codes, IplImage* mask, 
+										 IplImage* confidence, int sl_thresh){
+	CvSize size = cvGetSize(mask);
+	IplImage* threshold = cvCreateImage(size, IPL_DEPTH_8U, 1);
+	IplImage* black     = cvCreateImage(size, IPL_DEPTH_8U, 1);
+	cvCvtColor(gray_codes[0], threshold, CV_RGB2GRAY);
+	cvCvtColor(gray_codes[1], black,     CV_RGB2GRAY);
+	cvAbsDiff(threshold, black, mask);
+	cvCmpS(mask, sl_thresh, mask, CV_CMP_GE);
+	cvAddWeighted(threshold, 0.5, black, 0.5, 0, threshold);
+	if(confidence != NULL)
+		cvCopy(mask, confidence);
+	cvReleaseImage(&black);
+	return threshold;
+}
+
+// Eliminate invalid column/row estimates.
+// Note: This will exclude pixels if either the column or row is missing or erroneous.
+static void maskDecodedCodes(int proj_width, int proj_height,
+							 IplImage* decoded_cols, IplImage* decoded_rows, IplImage* mask){
+	IplImage* temp = cvCreateImage(cvGetSize(mask), IPL_DEPTH_8U, 1);
 	cvCmpS(decoded_cols, proj_width-1,  temp, CV_CMP_LE);
 	cvAnd(temp, mask, mask);
 	cvCmpS(decoded_cols, 0,  temp, CV_CMP_GE);
@@ -175,21 +354,246 @@ int decodeGrayCodes(int proj_width, int proj_height,
 	cvNot(mask, temp);
 	cvSet(decoded_cols, cvScalar(NULL), temp);
 	cvSet(decoded_rows, cvScalar(NULL), temp);
+	cvReleaseImage(&temp);
+}
+
+// Decode Gray codes.
+// Note: If single-pattern decoding is enabled, only the first code's inverse (i.e., the black
+//       image) is required. The optional confidence mask excludes pixels for which any bit is 
+//       within half of the contrast threshold of the per-pixel threshold (i.e., where the inverse
+//       codes would still be required).
+int decodeGrayCodes(int proj_width, int proj_height,
+					IplImage**& gray_codes, 
+					IplImage*& decoded_cols,
+					IplImage*& decoded_rows,
+					IplImage*& mask,
+					int& n_cols, int& n_rows,
+					int& col_shift, int& row_shift, 
+					int sl_thresh,
+					bool sl_single_pattern,
+					IplImage* confidence){
+
+	// Initialize image mask (indicates reconstructed pixels).
+	cvSet(mask, cvScalar(0));
+	IplImage* threshold = NULL;
+	if(sl_single_pattern)
+		threshold = createDecodingThreshold(gray_codes, mask, confidence, sl_thresh);
+
+	// Decode Gray codes for projector columns.
+	decodeGrayCodeBits(gray_codes, 1, n_cols, decoded_cols, mask, sl_thresh, threshold, confidence);
+	cvSubS(decoded_cols, cvScalar(col_shift), decoded_cols);
+
+	// Decode Gray codes for projector rows.
+	decodeGrayCodeBits(gray_codes, n_cols+1, n_rows, decoded_rows, mask, sl_thresh, threshold, confidence);
+	cvSubS(decoded_rows, cvScalar(row_shift), decoded_rows);
+
+	// Eliminate invalid column/row estimates.
+	maskDecodedCodes(proj_width, proj_height, decoded_cols, decoded_rows, mask);
+	if(confidence != NULL)
+		cvAnd(confidence, mask, confidence);
+	if(threshold != NULL)
+		cvReleaseImage(&threshold);
+
+	// Return without errors.
+	return 0;
+}
+
+// Evaluate the four-quadrant arctangent of y/x for an array of values (in radians, over [0,2*pi)).
+// Note: Uses the polynomial approximation of Abramowitz and Stegun (4.4.49) on [0,1], which has 
+//       a maximum error of 1e-5 radians. Four elements are evaluated at a time using SSE2.
+static void fastArctan2(const float* y, const float* x, float* angle, int n){
+
+	// Define polynomial coefficients and constants.
+	const float c1 = 0.9998660f, c3 = -0.3302995f, c5 = 0.1801410f, c7 = -0.0851330f, c9 = 0.0208351f;
+	const float half_pi = (float)(CV_PI/2), pi = (float)CV_PI, two_pi = (float)(2*CV_PI);
+
+	// Evaluate four elements at a time.
+	int i = 0;
+	const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	const __m128 zero = _mm_setzero_ps(), tiny = _mm_set1_ps(1e-20f);
+	for(; i+4<=n; i+=4){
+
+		// Evaluate arctangent of min(|x|,|y|)/max(|x|,|y|).
+		__m128 vy = _mm_loadu_ps(y+i);
+		__m128 vx = _mm_loadu_ps(x+i);
+		__m128 ay = _mm_andnot_ps(sign_mask, vy);
+		__m128 ax = _mm_andnot_ps(sign_mask, vx);
+		__m128 a  = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), tiny));
+		__m128 s  = _mm_mul_ps(a, a);
+		__m128 r  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(c9), s), _mm_set1_ps(c7));
+		r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(c5));
+		r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(c3));
+		r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(c1));
+		r = _mm_mul_ps(r, a);
+
+		// Map to the correct quadrant (using masks in place of branches).
+		__m128 m = _mm_cmpgt_ps(ay, ax);
+		r = _mm_or_ps(_mm_and_ps(m, _mm_sub_ps(_mm_set1_ps(half_pi), r)), _mm_andnot_ps(m, r));
+		m = _mm_cmplt_ps(vx, zero);
+		r = _mm_or_ps(_mm_and_ps(m, _mm_sub_ps(_mm_set1_ps(pi), r)), _mm_andnot_ps(m, r));
+		m = _mm_cmplt_ps(vy, zero);
+		r = _mm_or_ps(_mm_and_ps(m, _mm_sub_ps(_mm_set1_ps(two_pi), r)), _mm_andnot_ps(m, r));
+		_mm_storeu_ps(angle+i, r);
+	}
+
+	// Evaluate remaining elements.
+	for(; i<n; i++){
+		float ax = fabs(x[i]), ay = fabs(y[i]);
+		float m  = (ax > ay ? ax : ay);
+		float a  = (ax < ay ? ax : ay)/(m > 1e-20f ? m : 1e-20f);
+		float s  = a*a;
+		float r  = ((((c9*s + c7)*s + c5)*s + c3)*s + c1)*a;
+		if(ay > ax)
+			r = half_pi-r;
+		if(x[i] < 0)
+			r = pi-r;
+		if(y[i] < 0)
+			r = two_pi-r;
+		angle[i] = r;
+	}
+}
+
+// Decode a single axis of a phase-shifted sequence (coarse Gray codes followed by sinusoids).
+// Note: The wrapped phase is unwrapped using the coarse Gray code, which has a resolution of half 
+//       the sinusoid period. Any disagreement at a period boundary is resolved using the phase.
+static void decodePhaseShiftAxis(IplImage** codes, int first, int n_gray, int n_phase,
+								 int phase_period, int shift, 
+								 IplImage* decoded, IplImage* mask, IplImage* phase_mask,
+								 int sl_thresh, IplImage* threshold, IplImage* confidence){
+
+	// Decode the coarse Gray code.
+	decodeGrayCodeBits(codes, first, n_gray, decoded, mask, sl_thresh, threshold, confidence);
+
+	// Allocate temporary variables.
+	CvSize size = cvGetSize(decoded);
+	IplImage* gray_1  = cvCreateImage(size, IPL_DEPTH_8U,  1);
+	IplImage* gray_2  = cvCreateImage(size, IPL_DEPTH_8U,  1);
+	IplImage* diff_1  = cvCreateImage(size, IPL_DEPTH_32F, 1);
+	IplImage* diff_2  = cvCreateImage(size, IPL_DEPTH_32F, 1);
+	IplImage* sin_sum = cvCreateImage(size, IPL_DEPTH_32F, 1);
+	IplImage* cos_sum = cvCreateImage(size, IPL_DEPTH_32F, 1);
+	IplImage* phase   = cvCreateImage(size, IPL_DEPTH_32F, 1);
+
+	// Accumulate the quadrature components of the sinusoids.
+	// Note: Each sinusoid is differenced with its inverse (i.e., the sinusoid shifted by pi), 
+	//       which cancels the ambient illumination and doubles the modulation.
+	cvZero(sin_sum);
+	cvZero(cos_sum);
+	for(int j=0; j<n_phase; j++){
+		double delta = CV_PI*j/n_phase;
+		cvCvtColor(codes[2*(j+n_gray+first)],   gray_1, CV_RGB2GRAY);
+		cvCvtColor(codes[2*(j+n_gray+first)+1], gray_2, CV_RGB2GRAY);
+		cvConvert(gray_1, diff_1);
+		cvConvert(gray_2, diff_2);
+		cvSub(diff_1, diff_2, diff_1);
+		cvScaleAdd(diff_1, cvRealScalar(sin(delta)), sin_sum, sin_sum);
+		cvScaleAdd(diff_1, cvRealScalar(cos(delta)), cos_sum, cos_sum);
+	}
+
+	// Unwrap the phase and reject pixels with insufficient modulation.
+	// Note: The quadrature magnitude is n_phase times the sinusoid amplitude, so the threshold
+	//       is equivalent to the one used for the Gray codes (i.e., on the difference images).
+	float min_modulation = (float)(n_phase*sl_thresh/2.0);
+	for(int r=0; r<size.height; r++){
+		float* sin_data     = (float*)(sin_sum->imageData + r*sin_sum->widthStep);
+		float* cos_data     = (float*)(cos_sum->imageData + r*cos_sum->widthStep);
+		float* phase_data   = (float*)(phase->imageData   + r*phase->widthStep);
+		float* decoded_data = (float*)(decoded->imageData + r*decoded->widthStep);
+		uchar* mask_data    = (uchar*)(phase_mask->imageData + r*phase_mask->widthStep);
+		fastArctan2(sin_data, cos_data, phase_data, size.width);
+		for(int c=0; c<size.width; c++){
+			if(sin_data[c]*sin_data[c]+cos_data[c]*cos_data[c] < min_modulation*min_modulation)
+				mask_data[c] = 0;
+			float fraction = phase_data[c]/(float)(2*CV_PI);
+			int   half     = (int)decoded_data[c];
+			int   period   = half >> 1;
+			if(!(half & 1) && fraction > 0.75f)
+				period--;
+			else if((half & 1) && fraction < 0.25f)
+				period++;
+			decoded_data[c] = (period+fraction)*phase_period-shift;
+		}
+	}
 
 	// Free allocated resources.
 	cvReleaseImage(&gray_1);
 	cvReleaseImage(&gray_2);
-	cvReleaseImage(&bit_plane_1);
-	cvReleaseImage(&bit_plane_2);
-	cvReleaseImage(&temp);
+	cvReleaseImage(&diff_1);
+	cvReleaseImage(&diff_2);
+	cvReleaseImage(&sin_sum);
+	cvReleaseImage(&cos_sum);
+	cvReleaseImage(&phase);
+}
+
+// Decode phase-shifted sinusoids (with coarse Gray codes for phase unwrapping).
+// Note: Decoded columns/rows are fractional (i.e., sub-projector-pixel) correspondences and must
+//       be stored in floating-point images.
+int decodePhaseShiftCodes(int proj_width, int proj_height,
+						  IplImage**& codes, 
+						  IplImage*& decoded_cols,
+						  IplImage*& decoded_rows,
+						  IplImage*& mask,
+						  int& n_cols, int& n_rows,
+						  int& col_shift, int& row_shift, 
+						  int sl_thresh, int phase_steps, int phase_period,
+						  bool sl_single_pattern,
+						  IplImage* confidence){
+
+	// Initialize image masks (indicates reconstructed pixels).
+	// Note: Single-pattern decoding only applies to the coarse Gray codes.
+	IplImage* phase_mask = cvCreateImage(cvGetSize(mask), IPL_DEPTH_8U, 1);
+	cvSet(mask, cvScalar(0));
+	cvSet(phase_mask, cvScalar(255));
+	int n_phase = phase_steps/2;
+	IplImage* threshold = NULL;
+	if(sl_single_pattern)
+		threshold = createDecodingThreshold(codes, mask, confidence, sl_thresh);
+
+	// Decode projector columns.
+	cvZero(decoded_cols);
+	if(n_cols > 0)
+		decodePhaseShiftAxis(codes, 1, n_cols-n_phase, n_phase, phase_period, col_shift, 
+							 decoded_cols, mask, phase_mask, sl_thresh, threshold, confidence);
+
+	// Decode projector rows.
+	cvZero(decoded_rows);
+	if(n_rows > 0)
+		decodePhaseShiftAxis(codes, n_cols+1, n_rows-n_phase, n_phase, phase_period, row_shift, 
+							 decoded_rows, mask, phase_mask, sl_thresh, threshold, confidence);
+
+	// Eliminate invalid column/row estimates.
+	cvAnd(phase_mask, mask, mask);
+	maskDecodedCodes(proj_width, proj_height, decoded_cols, decoded_rows, mask);
+	if(confidence != NULL)
+		cvAnd(confidence, mask, confidence);
+
+	// Free allocated resources.
+	cvReleaseImage(&phase_mask);
+	if(threshold != NULL)
+		cvReleaseImage(&threshold);
 
 	// Return without errors.
 	return 0;
 }
 
-// Illuminate object with a structured light sequence.
-int slScan(CvCapture* capture, 
-		   IplImage**& proj_codes, IplImage**& cam_codes,
+// Determine whether the inverse of a code must be captured.
+// Note: With single-pattern decoding, only the inverse of the first code (i.e., the black image)
+//       and the inverses of any sinusoids (which supply the remaining phase shifts) are required.
+static bool slInverseRequired(int code, int n_cols, int n_rows, struct slParams* sl_params){
+	if(!sl_params->single_pattern || code == 0)
+		return true;
+	if(sl_params->pattern == 2){
+		int n_phase = sl_params->phase_steps/2;
+		if(code <= n_cols)
+			return code > n_cols-n_phase;
+		return code > n_cols+n_rows-n_phase;
+	}
+	return false;
+}
+
+// Illuminate object with a structured light sequence (one pattern at a time).
+int slScanSerial(CvCapture* capture, 
+				 IplImage**& proj_codes, IplImage**& proj_inverse_codes, IplImage**& cam_codes,
 		   int n_cols, int n_rows, 
 		   struct slParams* sl_params,
 		   struct slCalib*  sl_calib){
@@ -203,13 +607,14 @@ int slScan(CvCapture* capture,
 	cvWaitKey(1);
 
 	// Allocate storage for captured images.
+	// Note: Inverse codes that are not captured are left as NULL.
 	cam_codes = new IplImage* [2*(n_cols+n_rows+1)];
 	for(int i=0; i<2*(n_cols+n_rows+1); i++)
-		cam_codes[i] = cvCloneImage(cam_frame);
+		cam_codes[i] = (i%2 == 0 || slInverseRequired(i/2, n_cols, n_rows, sl_params)) ? 
+			cvCloneImage(cam_frame) : NULL;
 
 	// Capture structured light sequence.
     // Note: Assumes sequence is binary, so code and its inverse can be compared.
-	IplImage* inverse_code = cvCloneImage(proj_codes[0]);
 	for(int i=0; i<(n_cols+n_rows+1); i++){
 
 		// Display code.
@@ -222,9 +627,10 @@ int slScan(CvCapture* capture,
 		cvShowImageResampled("camWindow", cam_frame, sl_params->window_w, sl_params->window_h);
 		cvCopyImage(cam_frame, cam_codes[2*i]);
 
-		// Display inverse code.
-		cvSubRS(proj_codes[i], cvScalar(255), inverse_code);
-		cvCopy(inverse_code, proj_frame);
+		// Display inverse code (if required).
+		if(cam_codes[2*i+1] == NULL)
+			continue;
+		cvCopy(proj_inverse_codes[i], proj_frame);
 		cvScale(proj_frame, proj_frame, 2.*(sl_params->proj_gain/100.), 0);
 		cvShowImage("projWindow", proj_frame);
 		cvWaitKey(sl_params->delay);
@@ -235,12 +641,11 @@ int slScan(CvCapture* capture,
 	}
 
 	// Display black projector image.
-	cvSet(inverse_code, cvScalar(0, 0, 0));
-	cvShowImage("projWindow", inverse_code);
+	cvZero(proj_frame);
+	cvShowImage("projWindow", proj_frame);
 	cvWaitKey(1);
 
 	// Free allocated resources.
-	cvReleaseImage(&inverse_code);
 	cvReleaseImage(&proj_frame);
 
 	// Return without errors.
@@ -248,6 +653,279 @@ int slScan(CvCapture* capture,
 	return 0;
 }
 
+// Return a high-resolution timestamp (in ms).
+static double slTimestamp(){
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return 1000.0*(double)count.QuadPart/(double)frequency.QuadPart;
+}
+
+// Define state shared between the pipelined acquisition loop and the capture thread.
+// Note: Every displayed pattern is appended to the display sequence, along with the
+//       time at which it was shown. Frames are matched to the entry that was visible
+//       (after the display latency) for the frame's entire exposure.
+struct slAcquisition{
+	CvCapture*       capture;           // camera capture
+	struct slParams* sl_params;         // structured lighting parameters
+	IplImage**       cam_codes;         // destination for matched camera frames
+	int              n_codes;           // number of projected patterns (including inverses)
+	bool*            matched;           // flags indicating which patterns have a matched frame
+	int              n_matched;         // number of patterns with a matched frame
+	int              last_matched;      // most recently matched pattern (used for the preview)
+	int*             show_code;         // display sequence (pattern index of each entry)
+	double*          show_time;         // display sequence (time each entry was shown, in ms)
+	int              n_shown;           // number of entries in the display sequence
+	int              max_shown;         // capacity of the display sequence
+	int              n_frames;          // number of frames captured
+	double           first_frame_time;  // timestamp of the first captured frame (in ms)
+	double           frame_period;      // estimated camera frame period (in ms)
+	volatile bool    running;           // flag used to stop the capture thread
+	CRITICAL_SECTION lock;              // protects all of the above
+};
+
+// Capture frames continuously and match them to the displayed patterns.
+static DWORD WINAPI slCaptureThread(LPVOID param){
+	struct slAcquisition* acq = (struct slAcquisition*)param;
+	double scale = 2.*(acq->sl_params->cam_gain/100.);
+	while(acq->running){
+
+		// Capture next frame (timestamped when it is delivered).
+		IplImage* cam_frame = cvQueryFrame2(acq->capture, acq->sl_params, false);
+		double t = slTimestamp();
+		if(cam_frame == NULL)
+			continue;
+
+		// Update frame period estimate and find the pattern visible during the exposure.
+		int match = -1;
+		EnterCriticalSection(&acq->lock);
+		if(acq->n_frames == 0)
+			acq->first_frame_time = t;
+		else
+			acq->frame_period = (t-acq->first_frame_time)/acq->n_frames;
+		acq->n_frames++;
+		for(int i=acq->n_shown-1; i>=0 && acq->n_frames > 1; i--){
+			if(acq->show_time[i]+acq->sl_params->latency <= t-acq->frame_period){
+				if(i == acq->n_shown-1 || t <= acq->show_time[i+1]+acq->sl_params->latency)
+					match = acq->show_code[i];
+				break;
+			}
+		}
+		if(match >= 0 && acq->matched[match])
+			match = -1;
+		LeaveCriticalSection(&acq->lock);
+
+		// Store matched frame.
+		if(match >= 0){
+			cvConvertScale(cam_frame, acq->cam_codes[match], scale, 0);
+			EnterCriticalSection(&acq->lock);
+			acq->matched[match] = true;
+			acq->n_matched++;
+			acq->last_matched = match;
+			LeaveCriticalSection(&acq->lock);
+		}
+	}
+	return 0;
+}
+
+// Render a projector pattern (or its inverse) with the projector gain applied.
+static void slRenderPattern(IplImage** proj_codes, IplImage** proj_inverse_codes, int code, 
+							IplImage* proj_frame, struct slParams* sl_params){
+	if(code % 2)
+		cvScale(proj_inverse_codes[code/2], proj_frame, 2.*(sl_params->proj_gain/100.), 0);
+	else
+		cvScale(proj_codes[code/2], proj_frame, 2.*(sl_params->proj_gain/100.), 0);
+}
+
+// Illuminate object with a structured light sequence (pipelined acquisition).
+// Note: Frames are captured continuously on a separate thread. Each pattern is held for 
+//       a fixed number of camera frame periods, while the next pattern (or its inverse) is 
+//       rendered, so the display latency is only paid once per sequence rather than once 
+//       per pattern. Any pattern without a matched frame is re-displayed at the end.
+int slScanPipelined(CvCapture* capture, 
+					IplImage**& proj_codes, IplImage**& proj_inverse_codes, IplImage**& cam_codes,
+					int n_cols, int n_rows, 
+					struct slParams* sl_params,
+					struct slCalib*  sl_calib){
+
+	// Allocate storage for captured images.
+	// Note: Inverse codes that are not captured are left as NULL.
+	IplImage* cam_frame = cvQueryFrame2(capture, sl_params);
+	int n_codes = 2*(n_cols+n_rows+1);
+	cam_codes = new IplImage* [n_codes];
+	for(int i=0; i<n_codes; i++)
+		cam_codes[i] = (i%2 == 0 || slInverseRequired(i/2, n_cols, n_rows, sl_params)) ? 
+			cvCloneImage(cam_frame) : NULL;
+
+	// Create a window to display the (decimated) preview.
+	IplImage* preview = NULL;
+	if(sl_params->preview_decimation > 0){
+		preview = cvCreateImage(cvSize(sl_params->window_w, sl_params->window_h), cam_frame->depth, cam_frame->nChannels);
+		cvNamedWindow("camWindow", CV_WINDOW_AUTOSIZE);
+		HWND camWindow = (HWND)cvGetWindowHandle("camWindow");
+		BringWindowToTop(camWindow);
+		cvWaitKey(1);
+	}
+
+	// Allocate double-buffered projector frames.
+	IplImage* proj_frames[2];
+	for(int i=0; i<2; i++)
+		proj_frames[i] = cvCreateImage(cvSize(sl_params->proj_w, sl_params->proj_h), IPL_DEPTH_8U, 1);
+
+	// Initialize acquisition state and start the capture thread.
+	const int max_passes = 4;
+	struct slAcquisition acq;
+	acq.capture          = capture;
+	acq.sl_params        = sl_params;
+	acq.cam_codes        = cam_codes;
+	acq.n_codes          = n_codes;
+	acq.matched          = new bool [n_codes];
+	acq.n_matched        = 0;
+	acq.last_matched     = -1;
+	acq.max_shown        = max_passes*n_codes;
+	acq.show_code        = new int [acq.max_shown];
+	acq.show_time        = new double [acq.max_shown];
+	acq.n_shown          = 0;
+	acq.n_frames         = 0;
+	acq.first_frame_time = 0;
+	acq.frame_period     = 0;
+	acq.running          = true;
+	for(int i=0; i<n_codes; i++){
+		acq.matched[i] = (cam_codes[i] == NULL);
+		if(acq.matched[i])
+			acq.n_matched++;
+	}
+	InitializeCriticalSection(&acq.lock);
+	HANDLE thread = CreateThread(NULL, 0, slCaptureThread, &acq, 0, NULL);
+
+	// Wait for an estimate of the camera frame period.
+	// Note: If the camera stops delivering frames (e.g., it was disconnected), this gives up
+	//       after a timeout and falls back to the sequential acquisition below.
+	const double frame_timeout = 2000.0;
+	double t_timeout = slTimestamp()+frame_timeout;
+	int n_frames = 0;
+	while(n_frames < 5 && slTimestamp() < t_timeout){
+		cvWaitKey(10);
+		EnterCriticalSection(&acq.lock);
+		n_frames = acq.n_frames;
+		LeaveCriticalSection(&acq.lock);
+	}
+	bool timed_out = (n_frames < 5);
+
+	// Display the structured light sequence.
+	// Note: The first pass displays every pattern; later passes only display patterns
+	//       for which no frame was matched (e.g., due to dropped frames or jitter).
+	int n_previewed = 0, last_previewed = -1;
+	for(int pass=0; pass<max_passes && !timed_out; pass++){
+
+		// Determine which patterns must be displayed during this pass.
+		int* codes = new int [n_codes];
+		int n_pass = 0;
+		EnterCriticalSection(&acq.lock);
+		for(int i=0; i<n_codes; i++)
+			if(!acq.matched[i])
+				codes[n_pass++] = i;
+		double hold = (pass == 0) ? 
+			sl_params->hold_frames*acq.frame_period : sl_params->latency+(sl_params->hold_frames+1)*acq.frame_period;
+		LeaveCriticalSection(&acq.lock);
+		if(n_pass == 0){
+			delete[] codes;
+			break;
+		}
+
+		// Display each pattern, pre-rendering the next one while the current one is held.
+		slRenderPattern(proj_codes, proj_inverse_codes, codes[0], proj_frames[0], sl_params);
+		for(int k=0; k<n_pass; k++){
+			cvShowImage("projWindow", proj_frames[k%2]);
+			cvWaitKey(1);
+			double t = slTimestamp();
+			EnterCriticalSection(&acq.lock);
+			acq.show_code[acq.n_shown] = codes[k];
+			acq.show_time[acq.n_shown] = t;
+			acq.n_shown++;
+			LeaveCriticalSection(&acq.lock);
+			if(k+1 < n_pass)
+				slRenderPattern(proj_codes, proj_inverse_codes, codes[k+1], proj_frames[(k+1)%2], sl_params);
+
+			// Hold the pattern (updating the preview, if enabled).
+			while(slTimestamp() < t+hold){
+				if(preview != NULL){
+					EnterCriticalSection(&acq.lock);
+					int last_matched = acq.last_matched;
+					LeaveCriticalSection(&acq.lock);
+					if(last_matched != last_previewed && (n_previewed++ % sl_params->preview_decimation) == 0){
+						cvResize(cam_codes[last_matched], preview, CV_INTER_LINEAR);
+						cvShowImage("camWindow", preview);
+					}
+					last_previewed = last_matched;
+				}
+				int remaining = (int)(t+hold-slTimestamp());
+				cvWaitKey(remaining > 1 ? remaining : 1);
+			}
+		}
+
+		// Wait for the frames still in flight (i.e., exposed during the display latency).
+		double t_end = slTimestamp()+sl_params->latency+2*acq.frame_period;
+		int n_matched = 0;
+		while(n_matched < n_codes && slTimestamp() < t_end){
+			cvWaitKey(1);
+			EnterCriticalSection(&acq.lock);
+			n_matched = acq.n_matched;
+			LeaveCriticalSection(&acq.lock);
+		}
+		delete[] codes;
+	}
+
+	// Stop the capture thread.
+	acq.running = false;
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+	DeleteCriticalSection(&acq.lock);
+	if(!timed_out && acq.n_matched < n_codes)
+		printf("WARNING: %d of %d structured light frames could not be captured!\n", n_codes-acq.n_matched, n_codes);
+
+	// Display black projector image.
+	cvZero(proj_frames[0]);
+	cvShowImage("projWindow", proj_frames[0]);
+	cvWaitKey(1);
+
+	// Free allocated resources.
+	delete[] acq.matched;
+	delete[] acq.show_code;
+	delete[] acq.show_time;
+	cvReleaseImage(&proj_frames[0]);
+	cvReleaseImage(&proj_frames[1]);
+	if(preview != NULL){
+		cvReleaseImage(&preview);
+		cvDestroyWindow("camWindow");
+	}
+
+	// Fall back to the sequential acquisition if the camera timed out.
+	if(timed_out){
+		printf("WARNING: Camera did not deliver frames, using sequential acquisition!\n");
+		for(int i=0; i<n_codes; i++)
+			if(cam_codes[i] != NULL)
+				cvReleaseImage(&cam_codes[i]);
+		delete[] cam_codes;
+		cam_codes = NULL;
+		return slScanSerial(capture, proj_codes, proj_inverse_codes, cam_codes, n_cols, n_rows, sl_params, sl_calib);
+	}
+
+	// Return without errors.
+	return 0;
+}
+
+// Illuminate object with a structured light sequence.
+int slScan(CvCapture* capture, 
+		   IplImage**& proj_codes, IplImage**& proj_inverse_codes, IplImage**& cam_codes,
+		   int n_cols, int n_rows, 
+		   struct slParams* sl_params,
+		   struct slCalib*  sl_calib){
+	if(sl_params->pipeline)
+		return slScanPipelined(capture, proj_codes, proj_inverse_codes, cam_codes, n_cols, n_rows, sl_params, sl_calib);
+	return slScanSerial(capture, proj_codes, proj_inverse_codes, cam_codes, n_cols, n_rows, sl_params, sl_calib);
+}
+
 // Display a structured lighting decoding result (i.e., projector column/row to camera pixel correspondences).
 int displayDecodingResults(IplImage*& decoded_cols, 
 						   IplImage*& decoded_rows, 
@@ -335,7 +1013,58 @@ int displayDepthMap(CvMat*& depth_map,
 	return 0;
 }
 
+// Reject pixels whose decoded column/row and intensity match the background (prior to triangulation).
+// Note: Pixels are only rejected if the background model is valid and every scanned correspondence 
+//       is within the tolerance of the background capture. The remaining pixels are still tested 
+//       against the background depth statistics once their depth is known.
+static void rejectBackgroundCodes(struct slParams* sl_params, 
+								  struct slCalib* sl_calib,
+								  IplImage* texture_image,
+								  IplImage* decoded_cols, 
+								  IplImage* decoded_rows, 
+								  IplImage* gray_mask){
+
+	// Allocate temporary variables.
+	CvSize size = cvGetSize(gray_mask);
+	IplImage* background = cvCreateImage(size, IPL_DEPTH_8U,  1);
+	IplImage* gray_1     = cvCreateImage(size, IPL_DEPTH_8U,  1);
+	IplImage* gray_2     = cvCreateImage(size, IPL_DEPTH_8U,  1);
+	IplImage* diff       = cvCreateImage(size, IPL_DEPTH_32F, 1);
+
+	// Compare decoded columns/rows to the background.
+	cvCopy(sl_calib->background_mask, background);
+	if(sl_params->scan_cols){
+		cvAbsDiff(decoded_cols, sl_calib->background_cols, diff);
+		cvCmpS(diff, sl_params->background_code_thresh, gray_1, CV_CMP_LE);
+		cvAnd(gray_1, background, background);
+	}
+	if(sl_params->scan_rows){
+		cvAbsDiff(decoded_rows, sl_calib->background_rows, diff);
+		cvCmpS(diff, sl_params->background_code_thresh, gray_1, CV_CMP_LE);
+		cvAnd(gray_1, background, background);
+	}
+
+	// Compare intensity to the background image (i.e., the white image of the background capture).
+	cvCvtColor(texture_image, gray_1, CV_RGB2GRAY);
+	cvCvtColor(sl_calib->background_image, gray_2, CV_RGB2GRAY);
+	cvAbsDiff(gray_1, gray_2, gray_1);
+	cvCmpS(gray_1, sl_params->thresh, gray_1, CV_CMP_LE);
+	cvAnd(gray_1, background, background);
+
+	// Remove background pixels from the mask.
+	cvNot(background, background);
+	cvAnd(gray_mask, background, gray_mask);
+
+	// Free allocated resources.
+	cvReleaseImage(&background);
+	cvReleaseImage(&gray_1);
+	cvReleaseImage(&gray_2);
+	cvReleaseImage(&diff);
+}
+
 // Reconstruct the point cloud and the depth map from a structured light sequence.
+// Note: Points are rejected (i.e., nothing is written) if they lie outside the near/far clipping 
+//       planes or, if enabled, are consistent with the background model.
 int reconstructStructuredLight(struct slParams* sl_params, 
 					           struct slCalib* sl_calib,
 							   IplImage*& texture_image,
@@ -345,174 +1074,217 @@ int reconstructStructuredLight(struct slParams* sl_params,
 							   CvMat*&    points,
 							   CvMat*&    colors,
 							   CvMat*&    depth_map,
-							   CvMat*&    mask){
+							   CvMat*&    mask,
+							   bool       reject_background){
 	
 	// Define pointers to various image data elements (for fast pixel access).
 	int cam_nelems                 = sl_params->cam_w*sl_params->cam_h;
 	int proj_nelems                = sl_params->proj_w*sl_params->proj_h;
 	uchar*  background_mask_data   = (uchar*)sl_calib->background_mask->imageData;
 	int     background_mask_step   = sl_calib->background_mask->widthStep/sizeof(uchar);
+	float*  background_depth_data  = sl_calib->background_depth_map->data.fl;
+	float*  background_var_data    = sl_calib->background_depth_var->data.fl;
 	uchar*  gray_mask_data         = (uchar*)gray_mask->imageData;
 	int     gray_mask_step         = gray_mask->widthStep/sizeof(uchar);
-	ushort* gray_decoded_cols_data = (ushort*)gray_decoded_cols->imageData;
-	int     gray_decoded_cols_step = gray_decoded_cols->widthStep/sizeof(ushort);
-	ushort* gray_decoded_rows_data = (ushort*)gray_decoded_rows->imageData;
-	int     gray_decoded_rows_step = gray_decoded_rows->widthStep/sizeof(ushort);
-
-	// Create a temporary copy of the background depth map.
-	CvMat* background_depth_map = cvCloneMat(sl_calib->background_depth_map);
+	float*  gray_decoded_cols_data = (float*)gray_decoded_cols->imageData;
+	int     gray_decoded_cols_step = gray_decoded_cols->widthStep/sizeof(float);
+	float*  gray_decoded_rows_data = (float*)gray_decoded_rows->imageData;
+	int     gray_decoded_rows_step = gray_decoded_rows->widthStep/sizeof(float);
 
 	// By default, disable all pixels.
 	cvZero(mask);
 
+	// Reject pixels that clearly belong to the background (i.e., without triangulating them).
+	if(reject_background)
+		rejectBackgroundCodes(sl_params, sl_calib, texture_image, gray_decoded_cols, gray_decoded_rows, gray_mask);
+
+	// Define camera center (common to every camera ray).
+	float q[3];
+	for(int i=0; i<3; i++)
+		q[i] = sl_calib->cam_center->data.fl[i];
+
 	// Reconstruct point cloud and depth map.
 	for(int r=0; r<sl_params->cam_h; r++){
 		for(int c=0; c<sl_params->cam_w; c++){
 
 			// Reconstruct current point, if mask is non-zero.
-			if(gray_mask_data[r*gray_mask_step+c]){
-
-				// Reconstruct using either "ray-plane" or "ray-ray" triangulation.
-				if(sl_params->mode == 1){
-
-					// Allocate storage for row/column reconstructed points and depths.
-					float point_cols[3], point_rows[3];
-					float depth_cols, depth_rows;
-				
-					// Intersect camera ray with corresponding projector column.
-					if(sl_params->scan_cols){
-						float q[3], v[3], w[4];
-						int rc = (sl_params->cam_w)*r+c;
-						for(int i=0; i<3; i++){
-							q[i] = sl_calib->cam_center->data.fl[i];
-							v[i] = sl_calib->cam_rays->data.fl[rc+cam_nelems*i];
-						}
-						int corresponding_column = gray_decoded_cols_data[r*gray_decoded_cols_step+c];
-						for(int i=0; i<4; i++)
-							w[i] = sl_calib->proj_column_planes->data.fl[4*corresponding_column+i];
-						intersectLineWithPlane3D(q, v, w, point_cols, depth_cols);
-					}
+			if(!gray_mask_data[r*gray_mask_step+c])
+				continue;
+			int rc = (sl_params->cam_w)*r+c;
+			float point[3], depth = 0;
+
+			// Reconstruct using either "ray-plane" or "ray-ray" triangulation.
+			// Note: For "ray-plane" triangulation, the depth is predicted from the plane equation(s) 
+			//       and the point is only evaluated if the depth passes the rejection tests below.
+			float v[3];
+			for(int i=0; i<3; i++)
+				v[i] = sl_calib->cam_rays->data.fl[rc+cam_nelems*i];
+			if(sl_params->mode == 1){
+
+				// Predict depth from the corresponding projector column.
+				float depth_cols, depth_rows;
+				if(sl_params->scan_cols){
+					// Note: Fractional correspondences interpolate the neighboring column planes.
+					float w[4];
+					float corresponding_column = gray_decoded_cols_data[r*gray_decoded_cols_step+c];
+					int   column_0 = (int)corresponding_column;
+					int   column_1 = (column_0 < sl_params->proj_w-1) ? column_0+1 : column_0;
+					float alpha    = corresponding_column-column_0;
+					for(int i=0; i<4; i++)
+						w[i] = (1-alpha)*sl_calib->proj_column_planes->data.fl[4*column_0+i] +
+						          alpha *sl_calib->proj_column_planes->data.fl[4*column_1+i];
+					depth_cols = depthLineWithPlane3D(q, v, w);
+				}
 
-					// Intersect camera ray with corresponding projector row.
-					if(sl_params->scan_rows){
-						float q[3], v[3], w[4];
-						int rc = (sl_params->cam_w)*r+c;
-						for(int i=0; i<3; i++){
-							q[i] = sl_calib->cam_center->data.fl[i];
-							v[i] = sl_calib->cam_rays->data.fl[rc+cam_nelems*i];
-						}
-						int corresponding_row = gray_decoded_rows_data[r*gray_decoded_rows_step+c];
-						for(int i=0; i<4; i++)
-							w[i] = sl_calib->proj_row_planes->data.fl[4*corresponding_row+i];
-						intersectLineWithPlane3D(q, v, w, point_rows, depth_rows);
-					}
+				// Predict depth from the corresponding projector row.
+				if(sl_params->scan_rows){
+					// Note: Fractional correspondences interpolate the neighboring row planes.
+					float w[4];
+					float corresponding_row = gray_decoded_rows_data[r*gray_decoded_rows_step+c];
+					int   row_0 = (int)corresponding_row;
+					int   row_1 = (row_0 < sl_params->proj_h-1) ? row_0+1 : row_0;
+					float alpha = corresponding_row-row_0;
+					for(int i=0; i<4; i++)
+						w[i] = (1-alpha)*sl_calib->proj_row_planes->data.fl[4*row_0+i] +
+						          alpha *sl_calib->proj_row_planes->data.fl[4*row_1+i];
+					depth_rows = depthLineWithPlane3D(q, v, w);
+				}
 
-					// Average points of intersection (if row and column scanning are both enabled).
-					// Note: Eliminate any points that differ between row and column reconstructions.
-					if( sl_params->scan_cols && sl_params->scan_rows){
-						if(abs(depth_cols-depth_rows) < sl_params->dist_reject){
-							depth_map->data.fl[sl_params->cam_w*r+c] = (depth_cols+depth_rows)/2;
-							for(int i=0; i<3; i++)
-								points->data.fl[sl_params->cam_w*r+c+cam_nelems*i] = (point_cols[i]+point_rows[i])/2;
-						}
-						else
-							gray_mask_data[r*gray_mask_step+c] = 0;
-					}
-					else if(sl_params->scan_cols){
-						depth_map->data.fl[sl_params->cam_w*r+c] = depth_cols;
-						for(int i=0; i<3; i++)
-							points->data.fl[sl_params->cam_w*r+c+cam_nelems*i] = point_cols[i];
-					}
-					else if(sl_params->scan_rows){
-						depth_map->data.fl[sl_params->cam_w*r+c] = depth_rows;
-						for(int i=0; i<3; i++)
-							points->data.fl[sl_params->cam_w*r+c+cam_nelems*i] = point_rows[i];
-					}
-					else
+				// Average depths of intersection (if row and column scanning are both enabled).
+				// Note: Eliminate any points that differ between row and column reconstructions.
+				//       Since both points lie on the camera ray, averaging the depths is equivalent
+				//       to averaging the points of intersection.
+				if( sl_params->scan_cols && sl_params->scan_rows){
+					if(abs(depth_cols-depth_rows) >= sl_params->dist_reject){
 						gray_mask_data[r*gray_mask_step+c] = 0;
+						continue;
+					}
+					depth = (depth_cols+depth_rows)/2;
 				}
+				else if(sl_params->scan_cols)
+					depth = depth_cols;
+				else if(sl_params->scan_rows)
+					depth = depth_rows;
 				else{
-
-					// Reconstruct surface using "ray-ray" triangulation.
-					int corresponding_column = gray_decoded_cols_data[r*gray_decoded_cols_step+c];
-					int corresponding_row    = gray_decoded_rows_data[r*gray_decoded_rows_step+c];
-					float q1[3], q2[3], v1[3], v2[3], point[3], depth = 0;
-					int rc_cam  = (sl_params->cam_w)*r+c;
-					int rc_proj = (sl_params->proj_w)*corresponding_row+corresponding_column;
-					for(int i=0; i<3; i++){
-						q1[i] = sl_calib->cam_center->data.fl[i];
-						q2[i] = sl_calib->proj_center->data.fl[i];
-						v1[i] = sl_calib->cam_rays->data.fl[rc_cam+cam_nelems*i];
-						v2[i] = sl_calib->proj_rays->data.fl[rc_proj+proj_nelems*i];
-					}
-					intersectLineWithLine3D(q1, v1, q2, v2, point);
-					for(int i=0; i<3; i++)
-						depth += v1[i]*(point[i]-q1[i]);
-					depth_map->data.fl[rc_cam] = depth;
-					for(int i=0; i<3; i++)
-						points->data.fl[rc_cam+cam_nelems*i] = point[i];
+					gray_mask_data[r*gray_mask_step+c] = 0;
+					continue;
 				}
-
-				// Assign color using provided texture image.
-				// Note: Color channels are ordered as RGB, rather than OpenCV's default BGR.
-				uchar* texture_image_data = (uchar*)(texture_image->imageData + r*texture_image->widthStep);
+			}
+			else{
+
+			// Reconstruct surface using "ray-ray" triangulation.
+				// Note: Fractional correspondences bilinearly interpolate the projector rays.
+				float corresponding_column = gray_decoded_cols_data[r*gray_decoded_cols_step+c];
+				float corresponding_row    = gray_decoded_rows_data[r*gray_decoded_rows_step+c];
+				int   column_0 = (int)corresponding_column, row_0 = (int)corresponding_row;
+				int   column_1 = (column_0 < sl_params->proj_w-1) ? column_0+1 : column_0;
+				int   row_1    = (row_0    < sl_params->proj_h-1) ? row_0+1    : row_0;
+				float alpha    = corresponding_column-column_0, beta = corresponding_row-row_0;
+				float q2[3], v2[3];
+				int rc_proj[4] = {(sl_params->proj_w)*row_0+column_0, (sl_params->proj_w)*row_0+column_1,
+								  (sl_params->proj_w)*row_1+column_0, (sl_params->proj_w)*row_1+column_1};
+				for(int i=0; i<3; i++){
+					q2[i] = sl_calib->proj_center->data.fl[i];
+					v2[i] = (1-beta)*((1-alpha)*sl_calib->proj_rays->data.fl[rc_proj[0]+proj_nelems*i] +
+					                     alpha *sl_calib->proj_rays->data.fl[rc_proj[1]+proj_nelems*i]) +
+					           beta *((1-alpha)*sl_calib->proj_rays->data.fl[rc_proj[2]+proj_nelems*i] +
+					                     alpha *sl_calib->proj_rays->data.fl[rc_proj[3]+proj_nelems*i]);
+				}
+				intersectLineWithLine3D(q, v, q2, v2, point);
 				for(int i=0; i<3; i++)
-					colors->data.fl[sl_params->cam_w*r+c+cam_nelems*i] = (float)texture_image_data[3*c+(2-i)]/(float)255.0;
-
-				// Update valid pixel mask (e.g., points will only be saved if valid).
-				mask->data.fl[sl_params->cam_w*r+c] = 1;
+					depth += v[i]*(point[i]-q[i]);
+			}
 
-				// Reject any points outside near/far clipping planes.
-				if(depth_map->data.fl[sl_params->cam_w*r+c] < sl_params->dist_range[0] ||
-				   depth_map->data.fl[sl_params->cam_w*r+c] > sl_params->dist_range[1]){
-					gray_mask_data[r*gray_mask_step+c] = 0;
-					mask->data.fl[sl_params->cam_w*r+c] = 0;
-					depth_map->data.fl[sl_params->cam_w*r+c] = 0;
-					for(int i=0; i<3; i++)
-						points->data.fl[sl_params->cam_w*r+c+cam_nelems*i] = 0;
-					for(int i=0; i<3; i++)
-						colors->data.fl[sl_params->cam_w*r+c+cam_nelems*i] = 0;
-				}
+			// Reject any points outside near/far clipping planes.
+			if(depth < sl_params->dist_range[0] || depth > sl_params->dist_range[1]){
+				gray_mask_data[r*gray_mask_step+c] = 0;
+				continue;
+			}
 
-				// Reject background points.
-				// Note: Currently only uses depth to determine foreground vs. background pixels.
-				float depth_difference = 
-					background_depth_map->data.fl[sl_params->cam_w*r+c] - 
-					depth_map->data.fl[sl_params->cam_w*r+c];
-				if(depth_difference < sl_params->background_depth_thresh && 
-				   gray_mask_data[r*gray_mask_step+c] && 
-				   background_mask_data[r*background_mask_step+c]){
+			// Reject background points.
+			// Note: A point is kept only if it is closer than the background mean by more than the
+			//       given number of standard deviations (or the minimum background distance).
+			if(reject_background && background_mask_data[r*background_mask_step+c]){
+				float tolerance = sl_params->background_sigma*sqrt(background_var_data[rc]);
+				if(tolerance < sl_params->background_depth_thresh)
+					tolerance = sl_params->background_depth_thresh;
+				if(background_depth_data[rc]-depth < tolerance){
 					gray_mask_data[r*gray_mask_step+c] = 0;
-					mask->data.fl[sl_params->cam_w*r+c] = 0;
-					depth_map->data.fl[sl_params->cam_w*r+c] = 0;
-					for(int i=0; i<3; i++)
-						points->data.fl[sl_params->cam_w*r+c+cam_nelems*i] = 0;
-					for(int i=0; i<3; i++)
-						colors->data.fl[sl_params->cam_w*r+c+cam_nelems*i] = 0;
+					continue;
 				}
 			}
+
+			// Evaluate the point of intersection (for "ray-plane" triangulation).
+			if(sl_params->mode == 1)
+				for(int i=0; i<3; i++)
+					point[i] = q[i] + depth*v[i];
+
+			// Store reconstructed point and depth.
+			depth_map->data.fl[rc] = depth;
+			for(int i=0; i<3; i++)
+				points->data.fl[rc+cam_nelems*i] = point[i];
+
+			// Assign color using provided texture image.
+			// Note: Color channels are ordered as RGB, rather than OpenCV's default BGR.
+			uchar* texture_image_data = (uchar*)(texture_image->imageData + r*texture_image->widthStep);
+			for(int i=0; i<3; i++)
+				colors->data.fl[rc+cam_nelems*i] = (float)texture_image_data[3*c+(2-i)]/(float)255.0;
+
+			// Update valid pixel mask (e.g., points will only be saved if valid).
+			mask->data.fl[rc] = 1;
 		}
 	}
 
-	// Release allocated resources.
-	cvReleaseMat(&background_depth_map);
-
 	// Return without errors.
 	return 0;
 }
 
+// Reset the background model.
+void resetBackgroundModel(struct slCalib* sl_calib){
+	cvZero(sl_calib->background_depth_map);
+	cvZero(sl_calib->background_depth_var);
+	cvZero(sl_calib->background_count);
+	cvZero(sl_calib->background_image);
+	cvZero(sl_calib->background_mask);
+	cvSet(sl_calib->background_cols, cvScalar(-FLT_MAX));
+	cvSet(sl_calib->background_rows, cvScalar(-FLT_MAX));
+}
+
+// Update the background model with a background depth map.
+// Note: Maintains the running per-pixel mean and (population) variance of the background depth 
+//       using Welford's method, so any number of background captures can be accumulated.
+static void updateBackgroundModel(struct slCalib* sl_calib, CvMat* depth_map, CvMat* mask){
+	int nelems = depth_map->rows*depth_map->cols;
+	float* mean  = sl_calib->background_depth_map->data.fl;
+	float* var   = sl_calib->background_depth_var->data.fl;
+	float* count = sl_calib->background_count->data.fl;
+	for(int i=0; i<nelems; i++){
+		if(!mask->data.fl[i])
+			continue;
+		float depth = depth_map->data.fl[i];
+		float delta = depth-mean[i];
+		count[i] += 1;
+		mean[i]  += delta/count[i];
+		var[i]   += (delta*(depth-mean[i])-var[i])/count[i];
+	}
+	cvCmpS(sl_calib->background_count, 0, sl_calib->background_mask, CV_CMP_GT);
+}
+
 // Run the background capture (used to eliminate background points from reconstructions).
+// Note: Each capture is accumulated into the running statistics of the background model.
 int runBackgroundCapture(CvCapture* capture, 
 						 struct slParams* sl_params, 
 						 struct slCalib* sl_calib){
 
-	// Generate Gray codes.
+	// Get Gray codes or phase-shifted sinusoids (generated on first use).
 	IplImage** proj_gray_codes = NULL;
+	IplImage** proj_inverse_gray_codes = NULL;
 	int gray_ncols, gray_nrows;
 	int gray_colshift, gray_rowshift;
-	generateGrayCodes(sl_params->proj_w, sl_params->proj_h, proj_gray_codes, 
+	getGrayCodeBank(sl_params->proj_w, sl_params->proj_h, proj_gray_codes, proj_inverse_gray_codes,
 		gray_ncols, gray_nrows, gray_colshift, gray_rowshift, 
-		sl_params->scan_cols, sl_params->scan_rows);
+		sl_params->scan_cols, sl_params->scan_rows, 
+		(sl_params->pattern == 2) ? sl_params->phase_steps : 0, sl_params->phase_period);
 
 	// Capture live image stream (e.g., for adjusting object placement).
 	printf("Remove object, then press any key (in 'camWindow') to scan.\n");
@@ -521,41 +1293,58 @@ int runBackgroundCapture(CvCapture* capture,
 	// Illuminate the background using the Gray code sequence.
 	printf("Displaying the structured light sequence...\n");
 	IplImage** cam_gray_codes = NULL;
-	slScan(capture, proj_gray_codes, cam_gray_codes, gray_ncols, gray_nrows, sl_params, sl_calib);
+	slScan(capture, proj_gray_codes, proj_inverse_gray_codes, cam_gray_codes, gray_ncols, gray_nrows, sl_params, sl_calib);
 
 	// Save white image for background model.
 	cvCopyImage(cam_gray_codes[0], sl_calib->background_image);
 
 	// Decode the structured light sequence.
 	printf("Decoding the structured light sequence...\n");
-	IplImage* gray_decoded_cols = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_16U, 1);
-	IplImage* gray_decoded_rows = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_16U, 1);
-	decodeGrayCodes(sl_params->proj_w, sl_params->proj_h,
-					cam_gray_codes, 
-					gray_decoded_cols, gray_decoded_rows, sl_calib->background_mask,
-					gray_ncols, gray_nrows, 
-					gray_colshift, gray_rowshift, 
-					sl_params->thresh);
+	IplImage* gray_decoded_cols = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_32F, 1);
+	IplImage* gray_decoded_rows = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_32F, 1);
+	IplImage* gray_mask         = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_8U,  1);
+	if(sl_params->pattern == 2)
+		decodePhaseShiftCodes(sl_params->proj_w, sl_params->proj_h,
+							  cam_gray_codes, 
+							  gray_decoded_cols, gray_decoded_rows, gray_mask,
+							  gray_ncols, gray_nrows, 
+							  gray_colshift, gray_rowshift, 
+							  sl_params->thresh, sl_params->phase_steps, sl_params->phase_period,
+							  sl_params->single_pattern, NULL);
+	else
+		decodeGrayCodes(sl_params->proj_w, sl_params->proj_h,
+						cam_gray_codes, 
+						gray_decoded_cols, gray_decoded_rows, gray_mask,
+						gray_ncols, gray_nrows, 
+						gray_colshift, gray_rowshift, 
+						sl_params->thresh, sl_params->single_pattern, NULL);
 
 	// Reconstruct the point cloud and depth map.
 	printf("Reconstructing the point cloud and the depth map...\n");
-	CvMat *points  = cvCreateMat(3, sl_params->cam_h*sl_params->cam_w, CV_32FC1);
-	CvMat *colors  = cvCreateMat(3, sl_params->cam_h*sl_params->cam_w, CV_32FC1);
-	CvMat *mask    = cvCreateMat(1, sl_params->cam_h*sl_params->cam_w, CV_32FC1);
+	CvMat *points    = cvCreateMat(3, sl_params->cam_h*sl_params->cam_w, CV_32FC1);
+	CvMat *colors    = cvCreateMat(3, sl_params->cam_h*sl_params->cam_w, CV_32FC1);
+	CvMat *depth_map = cvCreateMat(sl_params->cam_h, sl_params->cam_w, CV_32FC1);
+	CvMat *mask      = cvCreateMat(1, sl_params->cam_h*sl_params->cam_w, CV_32FC1);
 	reconstructStructuredLight(sl_params, sl_calib, 
 							   cam_gray_codes[0],
-		                       gray_decoded_cols, gray_decoded_rows, sl_calib->background_mask,
-							   points, colors, sl_calib->background_depth_map, mask);
+		                       gray_decoded_cols, gray_decoded_rows, gray_mask,
+							   points, colors, depth_map, mask, false);
+
+	// Update the background model (i.e., accumulate the running depth statistics).
+	// Note: The decoded columns/rows are retained for early background rejection.
+	updateBackgroundModel(sl_calib, depth_map, mask);
+	cvCopy(gray_decoded_cols, sl_calib->background_cols, gray_mask);
+	cvCopy(gray_decoded_rows, sl_calib->background_rows, gray_mask);
+	printf("> Background model updated (%d pixels).\n", cvCountNonZero(sl_calib->background_mask));
 
 	// Free allocated resources.
 	cvReleaseImage(&gray_decoded_cols);
 	cvReleaseImage(&gray_decoded_rows);
+	cvReleaseImage(&gray_mask);
 	cvReleaseMat(&points);
 	cvReleaseMat(&colors);
+	cvReleaseMat(&depth_map);
 	cvReleaseMat(&mask);
-	for(int i=0; i<(gray_ncols+gray_nrows+1); i++)
-		cvReleaseImage(&proj_gray_codes[i]);
-	delete[] proj_gray_codes;
 	for(int i=0; i<2*(gray_ncols+gray_nrows+1); i++)
 		cvReleaseImage(&cam_gray_codes[i]);
 	delete[] cam_gray_codes;
@@ -570,13 +1359,15 @@ int runStructuredLight(CvCapture* capture,
 					   struct slCalib* sl_calib, 
 					   int scan_index){
 
-	// Generate Gray codes.
+	// Get Gray codes or phase-shifted sinusoids (generated on first use).
 	IplImage** proj_gray_codes = NULL;
+	IplImage** proj_inverse_gray_codes = NULL;
 	int gray_ncols, gray_nrows;
 	int gray_colshift, gray_rowshift;
-	generateGrayCodes(sl_params->proj_w, sl_params->proj_h, proj_gray_codes, 
+	getGrayCodeBank(sl_params->proj_w, sl_params->proj_h, proj_gray_codes, proj_inverse_gray_codes,
 		gray_ncols, gray_nrows, gray_colshift, gray_rowshift, 
-		sl_params->scan_cols, sl_params->scan_rows);
+		sl_params->scan_cols, sl_params->scan_rows, 
+		(sl_params->pattern == 2) ? sl_params->phase_steps : 0, sl_params->phase_period);
 
 	// Capture live image stream (e.g., for adjusting object placement).
 	printf("Position object, then press any key (in 'camWindow') to scan.\n");
@@ -585,7 +1376,7 @@ int runStructuredLight(CvCapture* capture,
 	// Illuminate the object using the Gray code sequence.
 	printf("Displaying the structured light sequence...\n");
 	IplImage** cam_gray_codes = NULL;
-	slScan(capture, proj_gray_codes, cam_gray_codes, 
+	slScan(capture, proj_gray_codes, proj_inverse_gray_codes, cam_gray_codes, 
 		   gray_ncols, gray_nrows, sl_params, sl_calib);
 
 	// Create output directory (if output enabled).
@@ -623,6 +1414,8 @@ int runStructuredLight(CvCapture* capture,
 	if(sl_params->save){
 		printf("Saving the structured light sequence...\n");
 		for(int i=0; i<2*(gray_ncols+gray_nrows+1); i++){
+			if(cam_gray_codes[i] == NULL)
+				continue;
 			sprintf(str, "%s\\%0.2d.png", outputDir, i);
 			cvSaveImage(str, cam_gray_codes[i]);
 		}
@@ -630,15 +1423,43 @@ int runStructuredLight(CvCapture* capture,
 
 	// Decode the structured light sequence.
 	printf("Decoding the structured light sequence...\n");
-	IplImage* gray_decoded_cols = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_16U, 1);
-	IplImage* gray_decoded_rows = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_16U, 1);
+	IplImage* gray_decoded_cols = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_32F, 1);
+	IplImage* gray_decoded_rows = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_32F, 1);
 	IplImage* gray_mask         = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_8U,  1);
-	decodeGrayCodes(sl_params->proj_w, sl_params->proj_h,
-					cam_gray_codes, 
-					gray_decoded_cols, gray_decoded_rows, gray_mask,
-					gray_ncols, gray_nrows, 
-					gray_colshift, gray_rowshift, 
-					sl_params->thresh);
+	IplImage* gray_confidence   = NULL;
+	if(sl_params->single_pattern)
+		gray_confidence = cvCreateImage(cvSize(sl_params->cam_w, sl_params->cam_h), IPL_DEPTH_8U, 1);
+	if(sl_params->pattern == 2)
+		decodePhaseShiftCodes(sl_params->proj_w, sl_params->proj_h,
+							  cam_gray_codes, 
+							  gray_decoded_cols, gray_decoded_rows, gray_mask,
+							  gray_ncols, gray_nrows, 
+							  gray_colshift, gray_rowshift, 
+							  sl_params->thresh, sl_params->phase_steps, sl_params->phase_period,
+							  sl_params->single_pattern, gray_confidence);
+	else
+		decodeGrayCodes(sl_params->proj_w, sl_params->proj_h,
+						cam_gray_codes, 
+						gray_decoded_cols, gray_decoded_rows, gray_mask,
+						gray_ncols, gray_nrows, 
+						gray_colshift, gray_rowshift, 
+						sl_params->thresh, sl_params->single_pattern, gray_confidence);
+
+	// Report (and save) the single-pattern decoding confidence.
+	// Note: Pixels outside the confidence mask have at least one ambiguous bit; if many pixels
+	//       are excluded, single-pattern decoding should be disabled (i.e., capture inverse codes).
+	if(gray_confidence != NULL){
+		int n_decoded = cvCountNonZero(gray_mask);
+		int n_confident = cvCountNonZero(gray_confidence);
+		printf("> %d of %d decoded pixels (%0.1f%%) have confident single-pattern bits.\n", 
+			n_confident, n_decoded, (n_decoded > 0) ? 100.0*n_confident/n_decoded : 0.0);
+		if(n_decoded > 0 && n_confident < 0.9*n_decoded)
+			printf("WARNING: Low single-pattern decoding confidence; consider disabling 'single_pattern_decoding'.\n");
+		if(sl_params->save){
+			sprintf(str, "%s\\confidence_mask.png", outputDir);
+			cvSaveImage(str, gray_confidence);
+		}
+	}
 
 	// Display and save the correspondences.
 	if(sl_params->display)
@@ -653,7 +1474,7 @@ int runStructuredLight(CvCapture* capture,
 	reconstructStructuredLight(sl_params, sl_calib, 
 							   cam_gray_codes[0],
 		                       gray_decoded_cols, gray_decoded_rows, gray_mask,
-							   points, colors, depth_map, mask);
+							   points, colors, depth_map, mask, true);
 
 	// Display and save the depth map.
 	if(sl_params->display)
@@ -692,22 +1513,28 @@ int runStructuredLight(CvCapture* capture,
 	// Save the point cloud.
 	printf("Saving the point cloud...\n");
 	sprintf(str, "%s\\%s\\%s_%0.2d.wrl", sl_params->outdir, sl_params->object, sl_params->object, scan_index);
-	if(savePointsVRML(str, points, NULL, colors, mask)){
+	// Note: The normals come from the camera pixel grid, neighbors farther apart than the
+	//       row/column rejection distance are treated as a depth discontinuity.
+	CvMat *normals = cvCreateMat(3, sl_params->cam_h*sl_params->cam_w, CV_32FC1);
+	estimateGridNormals(points, mask, sl_params->cam_w, sl_params->cam_h, 
+						sl_calib->cam_center->data.fl, sl_params->dist_reject, normals);
+	if(savePointsVRML(str, points, normals, colors, mask)){
 		printf("Scanning was not successful and must be repeated!\n");
+		cvReleaseMat(&normals);
 		return -1;
 	}
+	cvReleaseMat(&normals);
 
 	// Free allocated resources.
 	cvReleaseImage(&gray_decoded_cols);
 	cvReleaseImage(&gray_decoded_rows);
 	cvReleaseImage(&gray_mask);
+	if(gray_confidence != NULL)
+		cvReleaseImage(&gray_confidence);
 	cvReleaseMat(&points);
 	cvReleaseMat(&colors);
 	cvReleaseMat(&depth_map);
 	cvReleaseMat(&mask);
-	for(int i=0; i<(gray_ncols+gray_nrows+1); i++)
-		cvReleaseImage(&proj_gray_codes[i]);
-	delete[] proj_gray_codes;
 	for(int i=0; i<2*(gray_ncols+gray_nrows+1); i++)
 		cvReleaseImage(&cam_gray_codes[i]);
 	delete[] cam_gray_codes;
@@ -11,6 +11,9 @@
 //   camera is intersected with the corresponding projector column and/or row. In the later,
 //   the corresponding optical rays from the camera and projector are intersected; in this 
 //   case, the 3D point is assigned as the closest point to the two (generally skewed) rays.
+//   Two pattern families are implemented, including: (1) binary Gray codes and (2) phase-
+//   shifted sinusoids, unwrapped using coarse Gray codes, which provide sub-projector-pixel 
+//   correspondences from fewer images.
 //   
 // Details:
 //   Please read the SIGGRAPH 2009 course notes for additional details.
@@ -24,8 +27,15 @@
 //   Brown University
 //   July 2009
 
+// Reset the background model.
+void resetBackgroundModel(struct slCalib* sl_calib);
+
 // Run the background capture (used to eliminate background points from reconstructions).
+// Note: Each capture is accumulated into the running statistics of the background model.
 int runBackgroundCapture(CvCapture* capture, struct slParams* sl_params, struct slCalib* sl_calib);
 
 // Run the structured light scanner.
-int runStructuredLight(CvCapture* capture, struct slParams* sl_params, struct slCalib* sl_calib, int scan_index);
\ No newline at end of file
+int runStructuredLight(CvCapture* capture, struct slParams* sl_params, struct slCalib* sl_calib, int scan_index);
+
+// Release the cached Gray code bank (generated on the first scan).
+void releaseGrayCodeBank();
\ No newline at end of file
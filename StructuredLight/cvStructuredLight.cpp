@@ -49,6 +49,7 @@ void CreateDefaultProjectorCamera()
 	sl_calib.proj_rays              = cvCreateMat(3, proj_nelems, CV_32FC1);
 	sl_calib.proj_column_planes     = cvCreateMat(sl_params.proj_w, 4, CV_32FC1);
 	sl_calib.proj_row_planes        = cvCreateMat(sl_params.proj_h, 4, CV_32FC1);
+	sl_calib.geometry_cache         = NULL;
 }
 
 int LoadCameraProjector()
@@ -86,7 +87,10 @@ int LoadCameraProjector()
 		sl_calib.cam_extrinsic  = (CvMat*)cvLoad(str1);
 		sl_calib.proj_extrinsic = (CvMat*)cvLoad(str2);
 		sl_calib.procam_extrinsic_calib = true;
-		evaluateProCamGeometry(&sl_params, &sl_calib);
+		if(loadProCamGeometryCache(&sl_params, &sl_calib) != 0){
+			evaluateProCamGeometry(&sl_params, &sl_calib);
+			saveProCamGeometryCache(&sl_params, &sl_calib);
+		}
 		printf("Loaded previous extrinsic projector-camera calibration.\n");
 	}
 	else
@@ -94,11 +98,13 @@ int LoadCameraProjector()
 
 	// Initialize background model.
 	sl_calib.background_depth_map = cvCreateMat(sl_params.cam_h, sl_params.cam_w, CV_32FC1);
+	sl_calib.background_depth_var = cvCreateMat(sl_params.cam_h, sl_params.cam_w, CV_32FC1);
+	sl_calib.background_count     = cvCreateMat(sl_params.cam_h, sl_params.cam_w, CV_32FC1);
 	sl_calib.background_image     = cvCreateImage(cvSize(sl_params.cam_w, sl_params.cam_h), IPL_DEPTH_8U, 3);
 	sl_calib.background_mask      = cvCreateImage(cvSize(sl_params.cam_w, sl_params.cam_h), IPL_DEPTH_8U, 1);
-	cvSet(sl_calib.background_depth_map, cvScalar(FLT_MAX));
-	cvZero(sl_calib.background_image);
-	cvSet(sl_calib.background_mask, cvScalar(255));
+	sl_calib.background_cols      = cvCreateImage(cvSize(sl_params.cam_w, sl_params.cam_h), IPL_DEPTH_32F, 1);
+	sl_calib.background_rows      = cvCreateImage(cvSize(sl_params.cam_w, sl_params.cam_h), IPL_DEPTH_32F, 1);
+	resetBackgroundModel(&sl_calib);
 
 	return 1;
 }
@@ -224,6 +230,7 @@ int main(int argc, char* argv[])
 	sl_calib.proj_rays              = cvCreateMat(3, proj_nelems, CV_32FC1);
 	sl_calib.proj_column_planes     = cvCreateMat(sl_params.proj_w, 4, CV_32FC1);
 	sl_calib.proj_row_planes        = cvCreateMat(sl_params.proj_h, 4, CV_32FC1);
+	sl_calib.geometry_cache         = NULL;
 	
 	// Load intrinsic camera calibration parameters (if found).
 	char str1[1024], str2[1024];
@@ -258,7 +265,10 @@ int main(int argc, char* argv[])
 		sl_calib.cam_extrinsic  = (CvMat*)cvLoad(str1);
 		sl_calib.proj_extrinsic = (CvMat*)cvLoad(str2);
 		sl_calib.procam_extrinsic_calib = true;
-		evaluateProCamGeometry(&sl_params, &sl_calib);
+		if(loadProCamGeometryCache(&sl_params, &sl_calib) != 0){
+			evaluateProCamGeometry(&sl_params, &sl_calib);
+			saveProCamGeometryCache(&sl_params, &sl_calib);
+		}
 		printf("Loaded previous extrinsic projector-camera calibration.\n");
 	}
 	else
@@ -266,11 +276,13 @@ int main(int argc, char* argv[])
 
 	// Initialize background model.
 	sl_calib.background_depth_map = cvCreateMat(sl_params.cam_h, sl_params.cam_w, CV_32FC1);
+	sl_calib.background_depth_var = cvCreateMat(sl_params.cam_h, sl_params.cam_w, CV_32FC1);
+	sl_calib.background_count     = cvCreateMat(sl_params.cam_h, sl_params.cam_w, CV_32FC1);
 	sl_calib.background_image     = cvCreateImage(cvSize(sl_params.cam_w, sl_params.cam_h), IPL_DEPTH_8U, 3);
 	sl_calib.background_mask      = cvCreateImage(cvSize(sl_params.cam_w, sl_params.cam_h), IPL_DEPTH_8U, 1);
-	cvSet(sl_calib.background_depth_map, cvScalar(FLT_MAX));
-	cvZero(sl_calib.background_image);
-	cvSet(sl_calib.background_mask, cvScalar(255));
+	sl_calib.background_cols      = cvCreateImage(cvSize(sl_params.cam_w, sl_params.cam_h), IPL_DEPTH_32F, 1);
+	sl_calib.background_rows      = cvCreateImage(cvSize(sl_params.cam_w, sl_params.cam_h), IPL_DEPTH_32F, 1);
+	resetBackgroundModel(&sl_calib);
 
 	// Initialize scan counter (used to index each scan iteration).
 	int scan_index = 0;
@@ -302,17 +314,12 @@ int main(int argc, char* argv[])
 		}
 		else if(cvKey == 'b'){
 			printf("\n> Scanning background...\n");
-			cvSet(sl_calib.background_depth_map, cvScalar(FLT_MAX));
-			cvZero(sl_calib.background_image);
-			cvSet(sl_calib.background_mask, cvScalar(255));
 			runBackgroundCapture(capture, &sl_params, &sl_calib);
 			cvKey = NULL;
 		}
 		else if(cvKey == 'r'){
 			printf("\n> Resetting background...\n");
-			cvSet(sl_calib.background_depth_map, cvScalar(FLT_MAX));
-			cvZero(sl_calib.background_image);
-			cvSet(sl_calib.background_mask, cvScalar(255));
+			resetBackgroundModel(&sl_calib);
 			cvKey = NULL;
 		}
 		else if(cvKey == 'c'){
@@ -340,7 +347,7 @@ int main(int argc, char* argv[])
 		if(cvKey == NULL){
 			printf("\nPress the following keys for the corresponding functions.\n");
 			printf("'S': Run scanner\n");
-			printf("'B': Estimate background\n");
+			printf("'B': Add background capture (accumulated until reset)\n");
 			printf("'R': Reset background\n");
 			printf("'C': Calibrate camera\n");
 			printf("'P': Calibrate projector\n");
@@ -354,6 +361,8 @@ int main(int argc, char* argv[])
 	}
 
 	// Release allocated resources.
+	releaseProCamGeometryCache(&sl_calib);
+	releaseGrayCodeBank();
 	cvReleaseMat(&sl_calib.cam_intrinsic);
 	cvReleaseMat(&sl_calib.cam_distortion);
 	cvReleaseMat(&sl_calib.cam_extrinsic);
@@ -368,8 +377,12 @@ int main(int argc, char* argv[])
 	cvReleaseMat(&sl_calib.proj_row_planes);
 	cvReleaseImage(&proj_frame);
 	cvReleaseMat(&sl_calib.background_depth_map);
+	cvReleaseMat(&sl_calib.background_depth_var);
+	cvReleaseMat(&sl_calib.background_count);
 	cvReleaseImage(&sl_calib.background_image);
 	cvReleaseImage(&sl_calib.background_mask);
+	cvReleaseImage(&sl_calib.background_cols);
+	cvReleaseImage(&sl_calib.background_rows);
 
 	// Exit without errors.
 	cvReleaseCapture(&capture);
@@ -64,16 +64,26 @@ struct slParams{
 	int   mode;                     // structured light reconstruction mode (1 = "ray-plane", 2 = "ray-ray")
 	bool  scan_cols;                // enable/disable column scanning
 	bool  scan_rows;                // enable/disable row scanning
+	int   pattern;                  // structured light pattern family (1 = Gray codes, 2 = phase-shifted sinusoids with Gray code unwrapping)
+	int   phase_steps;              // number of phase shifts per sinusoid (even, phase-shifting patterns only)
+	int   phase_period;             // period of the sinusoids (in projector pixels, power of two, phase-shifting patterns only)
 	int   delay;                    // frame delay between projection and image capture (in ms)
+	bool  pipeline;                 // enable/disable pipelined acquisition (threaded capture, frames matched to patterns by timestamp)
+	int   latency;                  // delay between displaying a pattern and it being visible to the camera (in ms, pipelined acquisition only)
+	int   hold_frames;              // number of camera frame periods each pattern is displayed (pipelined acquisition only)
+	bool  single_pattern;           // enable/disable single-pattern decoding (inverse Gray codes are not captured; bits are thresholded at the white/black midpoint)
 	int   thresh;                   // minimum contrast threshold for decoding (maximum of 255)
 	float dist_range[2];            // {minimum, maximum} distance (from camera), otherwise point is rejected
 	float dist_reject;              // rejection distance (for outlier removal) if row and column scanning are both enabled (in mm)
 	float background_depth_thresh;  // threshold distance for background removal (in mm)	
+	float background_sigma;         // number of standard deviations (of the background depth) for background removal
+	float background_code_thresh;   // maximum difference from the background's decoded column/row (in projector pixels) for early background removal
 
 	// Visualization options.
 	bool display;                   // enable/disable display of intermediate results (e.g., image sequence, calibration data, etc.)
 	int window_w;                   // camera display window width (height is derived)
 	int window_h;                   // camera display window width (derived parameter)
+	int preview_decimation;         // display every n-th captured frame during acquisition (0 disables the preview)
 };
 
 // Define structure for structured lighting calibration parameters.
@@ -97,6 +107,7 @@ struct slCalib{
 	CvMat* proj_rays;               // optical rays for each projector pixel
 	CvMat* proj_column_planes;      // plane equations describing every projector column
 	CvMat* proj_row_planes;         // plane equations describing every projector row
+	void*  geometry_cache;          // mapped view of the binary geometry cache (NULL if tables are heap-allocated)
 
 	// Flags to indicate calibration status.
 	bool cam_intrinsic_calib;       // flag to indicate state of intrinsic camera calibration
@@ -104,7 +115,11 @@ struct slCalib{
 	bool procam_extrinsic_calib;    // flag to indicate state of extrinsic projector-camera calibration
 
 	// Background model (used to segment foreground objects of interest from static background).
-	CvMat*    background_depth_map; // background depth map
+	CvMat*    background_depth_map; // background depth map (running mean across background captures)
+	CvMat*    background_depth_var; // background depth variance (running estimate across background captures)
+	CvMat*    background_count;     // number of background depth samples for each pixel
+	IplImage* background_cols;      // decoded projector columns of the background
+	IplImage* background_rows;      // decoded projector rows of the background
 	IplImage* background_image;     // background image 
 	IplImage* background_mask;      // background mask
 };
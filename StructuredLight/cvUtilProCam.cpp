@@ -100,6 +100,20 @@ void intersectLineWithPlane3D(const float* q,
 		p[i] = q[i] + depth*v[i];
 }
 
+// Find the depth (i.e., line parameter) of the intersection between a 3D plane and a 3D line.
+// Note: Equivalent to intersectLineWithPlane3D, but does not evaluate the point of intersection 
+//       (e.g., so that points can be rejected by depth before they are reconstructed).
+float depthLineWithPlane3D(const float* q, 
+						   const float* v, 
+						   const float* w){
+	float n_dot_q = 0, n_dot_v = 0;
+	for(int i=0; i<3; i++){
+		n_dot_q += w[i]*q[i];
+		n_dot_v += w[i]*v[i];
+	}
+	return (w[3]-n_dot_q)/n_dot_v;
+}
+
 // Find closest point to two 3D lines.
 // Note: Finds the closest 3D point between two 3D lines defined in parametric
 ///      form (i.e., containing a point Q and spanned by the vector V). Note, 
@@ -133,6 +147,82 @@ void intersectLineWithLine3D(const float* q1,
 		p[i] = ( (q1[i]+s*v1[i]) + (q2[i]+t*v2[i]) )/2;
 }
 
+// Estimate per-point normals for an organized (camera-pixel) point cloud.
+// Note: Each normal is the cross product of the horizontal and vertical central differences
+//       on the camera grid (one-sided where a neighbor is missing). Neighbors farther than
+//       max_dist are treated as a depth discontinuity and ignored. Normals are oriented
+//       towards the camera center; pixels without enough neighbors get a zero normal.
+void estimateGridNormals(const CvMat* points, 
+						 const CvMat* mask,
+						 int width,
+						 int height,
+						 const float* center,
+						 float max_dist,
+						 CvMat* normals){
+
+	// Define pointers to the point, mask, and normal data (each point is a column).
+	int     nelems      = width*height;
+	float*  points_data = points->data.fl;
+	float*  mask_data   = mask->data.fl;
+	float*  normal_data = normals->data.fl;
+	float   max_dist2   = max_dist*max_dist;
+	cvZero(normals);
+
+	// Evaluate the normals (each row is independent).
+	int r;
+	#pragma omp parallel for schedule(dynamic,16)
+	for(r=0; r<height; r++){
+		for(int c=0; c<width; c++){
+			int rc = width*r+c;
+			if(mask_data[rc] == 0)
+				continue;
+
+			// Find the usable neighbor on each side (left, right, up, down), or use the point itself.
+			int side[4] = {rc, rc, rc, rc};
+			int dc[4] = {-1, 1, 0, 0}, dr[4] = {0, 0, -1, 1};
+			for(int s=0; s<4; s++){
+				int nc = c+dc[s], nr = r+dr[s];
+				if(nc < 0 || nr < 0 || nc >= width || nr >= height)
+					continue;
+				int n = width*nr+nc;
+				if(mask_data[n] == 0)
+					continue;
+				float d2 = 0;
+				for(int i=0; i<3; i++){
+					float d = points_data[n+nelems*i]-points_data[rc+nelems*i];
+					d2 += d*d;
+				}
+				if(d2 <= max_dist2)
+					side[s] = n;
+			}
+			if((side[0] == rc && side[1] == rc) || (side[2] == rc && side[3] == rc))
+				continue;
+
+			// Evaluate the normal from the two tangent vectors.
+			float u[3], v[3], normal[3];
+			for(int i=0; i<3; i++){
+				u[i] = points_data[side[1]+nelems*i]-points_data[side[0]+nelems*i];
+				v[i] = points_data[side[3]+nelems*i]-points_data[side[2]+nelems*i];
+			}
+			normal[0] = u[1]*v[2]-u[2]*v[1];
+			normal[1] = u[2]*v[0]-u[0]*v[2];
+			normal[2] = u[0]*v[1]-u[1]*v[0];
+			float norm = sqrt(normal[0]*normal[0]+normal[1]*normal[1]+normal[2]*normal[2]);
+			if(norm == 0)
+				continue;
+
+			// Orient the normal towards the camera center.
+			float facing = 0;
+			for(int i=0; i<3; i++)
+				facing += normal[i]*(center[i]-points_data[rc+nelems*i]);
+			if(facing < 0)
+				norm = -norm;
+			for(int i=0; i<3; i++)
+				normal_data[rc+nelems*i] = normal[i]/norm;
+		}
+	}
+}
+
 // Define camera capture (support Logitech QuickCam 9000 raw-mode).
 IplImage* cvQueryFrame2(CvCapture* capture, struct slParams* sl_params, bool return_raw){
 	IplImage* cam_frame = cvQueryFrame(capture);
@@ -378,18 +468,28 @@ void writeConfiguration(const char* filename, struct slParams* sl_params){
 	cvWriteInt(fs,  "mode",                           sl_params->mode);
 	cvWriteInt(fs,  "reconstruct_columns",            sl_params->scan_cols);
 	cvWriteInt(fs,  "reconstruct_rows",               sl_params->scan_rows);
+	cvWriteInt(fs,  "pattern_family",                 sl_params->pattern);
+	cvWriteInt(fs,  "phase_shift_steps",              sl_params->phase_steps);
+	cvWriteInt(fs,  "phase_shift_period_pixels",      sl_params->phase_period);
 	cvWriteInt(fs,  "frame_delay_ms",                 sl_params->delay);
+	cvWriteInt(fs,  "pipelined_acquisition",          sl_params->pipeline);
+	cvWriteInt(fs,  "display_latency_ms",             sl_params->latency);
+	cvWriteInt(fs,  "pattern_hold_frames",            sl_params->hold_frames);
+	cvWriteInt(fs,  "single_pattern_decoding",        sl_params->single_pattern);
 	cvWriteInt(fs,  "minimum_contrast_threshold",     sl_params->thresh);
 	cvWriteReal(fs, "minimum_distance_mm",            sl_params->dist_range[0]);
 	cvWriteReal(fs, "maximum_distance_mm",            sl_params->dist_range[1]);
 	cvWriteReal(fs, "maximum_distance_variation_mm",  sl_params->dist_reject);
 	cvWriteReal(fs, "minimum_background_distance_mm", sl_params->background_depth_thresh);
+	cvWriteReal(fs, "background_rejection_sigma",     sl_params->background_sigma);
+	cvWriteReal(fs, "background_code_tolerance",      sl_params->background_code_thresh);
 	cvEndWriteStruct(fs);
 
 	// Write visualization options.
 	cvStartWriteStruct(fs, "visualization", CV_NODE_MAP);
 	cvWriteInt(fs, "display_intermediate_results", sl_params->display);
 	cvWriteInt(fs, "display_window_width_pixels",  sl_params->window_w);
+	cvWriteInt(fs, "preview_decimation",           sl_params->preview_decimation);
 	cvEndWriteStruct(fs);
 
 	// Close file storage for XML-formatted configuration file.
@@ -451,17 +551,27 @@ void readConfiguration(const char* filename, struct slParams* sl_params){
 	sl_params->mode                    =         cvReadIntByName(fs,  m, "mode",                               2);
 	sl_params->scan_cols               =        (cvReadIntByName(fs,  m, "reconstruct_columns",                1) != 0);
 	sl_params->scan_rows               =        (cvReadIntByName(fs,  m, "reconstruct_rows",                   1) != 0);
+	sl_params->pattern                 =         cvReadIntByName(fs,  m, "pattern_family",                     1);
+	sl_params->phase_steps             =         cvReadIntByName(fs,  m, "phase_shift_steps",                  4);
+	sl_params->phase_period            =         cvReadIntByName(fs,  m, "phase_shift_period_pixels",         16);
 	sl_params->delay                   =         cvReadIntByName(fs,  m, "frame_delay_ms",                   200);
+	sl_params->pipeline                =        (cvReadIntByName(fs,  m, "pipelined_acquisition",              1) != 0);
+	sl_params->latency                 =         cvReadIntByName(fs,  m, "display_latency_ms",               100);
+	sl_params->hold_frames             =         cvReadIntByName(fs,  m, "pattern_hold_frames",                2);
+	sl_params->single_pattern          =        (cvReadIntByName(fs,  m, "single_pattern_decoding",            0) != 0);
 	sl_params->thresh                  =         cvReadIntByName(fs,  m, "minimum_contrast_threshold",        32);
 	sl_params->dist_range[0]           = (float) cvReadRealByName(fs, m, "minimum_distance_mm",              0.0);
 	sl_params->dist_range[1]           = (float) cvReadRealByName(fs, m, "maximum_distance_mm",            1.0e4);
 	sl_params->dist_reject             = (float) cvReadRealByName(fs, m, "maximum_distance_variation_mm",   10.0);
 	sl_params->background_depth_thresh = (float) cvReadRealByName(fs, m, "minimum_background_distance_mm",  20.0);
+	sl_params->background_sigma        = (float) cvReadRealByName(fs, m, "background_rejection_sigma",       3.0);
+	sl_params->background_code_thresh  = (float) cvReadRealByName(fs, m, "background_code_tolerance",        1.0);
 
 	// Read visualization options.
 	m = cvGetFileNodeByName(fs, 0, "visualization");
-	sl_params->display  = (cvReadIntByName(fs, m, "display_intermediate_results",   1) != 0);
-	sl_params->window_w =  cvReadIntByName(fs, m, "display_window_width_pixels",  640);
+	sl_params->display            = (cvReadIntByName(fs, m, "display_intermediate_results",   1) != 0);
+	sl_params->window_w           =  cvReadIntByName(fs, m, "display_window_width_pixels",  640);
+	sl_params->preview_decimation =  cvReadIntByName(fs, m, "preview_decimation",             4);
 
 	// Enable both row and column scanning, if "ray-ray" reconstruction mode is enabled.
 	if(sl_params->mode == 2){
@@ -469,6 +579,18 @@ void readConfiguration(const char* filename, struct slParams* sl_params){
 		sl_params->scan_rows = true;
 	}
 
+	// Restrict phase-shifting parameters.
+	// Note: Requires an even number of steps (each sinusoid is paired with its inverse) and a 
+	//       power-of-two period no larger than the Gray-coded extent of the projector.
+	if(sl_params->phase_steps < 4)
+		sl_params->phase_steps = 4;
+	sl_params->phase_steps += sl_params->phase_steps % 2;
+	int max_period = (int)pow(2.0, ceil(log2(MIN(sl_params->proj_w, sl_params->proj_h))));
+	int period = 4;
+	while(period < sl_params->phase_period && period < max_period)
+		period *= 2;
+	sl_params->phase_period = period;
+
 	// Set camera visualization window dimensions.
 	sl_params->window_h = (int)ceil((float)sl_params->window_w*((float)sl_params->cam_h/(float)sl_params->cam_w));
 
@@ -26,9 +26,15 @@ void cvFitPlane(const CvMat* points, float* plane);
 // Find intersection between a 3D plane and a 3D line.
 void intersectLineWithPlane3D(const float* q, const float* v, const float* w, float* p, float& depth);
 
+// Find the depth (i.e., line parameter) of the intersection between a 3D plane and a 3D line.
+float depthLineWithPlane3D(const float* q, const float* v, const float* w);
+
 // Find closest point to two 3D lines.
 void intersectLineWithLine3D(const float* q1, const float* v1, const float* q2, const float* v2, float* p);
 
+// Estimate per-point normals for an organized (camera-pixel) point cloud.
+void estimateGridNormals(const CvMat* points, const CvMat* mask, int width, int height, const float* center, float max_dist, CvMat* normals);
+
 // Define camera capture (support Logitech QuickCam 9000 raw-mode).
 IplImage* cvQueryFrame2(CvCapture* capture, struct slParams* sl_params, bool return_raw = false);
 